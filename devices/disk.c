@@ -32,6 +32,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +48,14 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* Upper bound on the number of sectors moved per DRQ block by
+   READ/WRITE MULTIPLE.  One page worth of sectors is all the
+   swap path ever asks for. */
+#define MULTIPLE_MAX 8
 
 /* An ATA device. */
 struct disk {
@@ -56,9 +65,12 @@ struct disk {
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	int multiple;               /* Sectors per DRQ block for READ/WRITE
+								   MULTIPLE, or 0 if unsupported. */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+	long long cmd_cnt;          /* Number of read/write commands issued. */
 };
 
 /* An ATA channel (aka controller).
@@ -83,8 +95,9 @@ static struct channel channels[CHANNEL_CNT];
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
+static void set_multiple_mode (struct disk *, int max_multiple);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t sec_cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -132,8 +145,9 @@ disk_init (void) {
 
 			d->is_ata = false;
 			d->capacity = 0;
+			d->multiple = 0;
 
-			d->read_cnt = d->write_cnt = 0;
+			d->read_cnt = d->write_cnt = d->cmd_cnt = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -167,8 +181,8 @@ disk_print_stats (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get (chan_no, dev_no);
 			if (d != NULL && d->is_ata)
-				printf ("%s: %lld reads, %lld writes\n",
-						d->name, d->read_cnt, d->write_cnt);
+				printf ("%s: %lld reads, %lld writes, %lld commands\n",
+						d->name, d->read_cnt, d->write_cnt, d->cmd_cnt);
 		}
 	}
 }
@@ -216,13 +230,14 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
 	d->read_cnt++;
+	d->cmd_cnt++;
 	lock_release (&c->lock);
 }
 
@@ -240,13 +255,92 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
 	output_sector (c, buffer);
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
+	d->cmd_cnt++;
+	lock_release (&c->lock);
+}
+
+/* Reads SEC_CNT consecutive sectors starting at SEC_NO from disk
+   D into BUFFER, which must have room for SEC_CNT *
+   DISK_SECTOR_SIZE bytes.  The whole range is transferred by a
+   single command: READ MULTIPLE if the disk supports it, which
+   interrupts once per block of D->multiple sectors, otherwise
+   READ SECTOR with a sector count, which interrupts once per
+   sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t sec_cnt) {
+	struct channel *c;
+	uint8_t *p = buffer;
+	size_t block, left;
+
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (sec_cnt > 0 && sec_cnt < 256);
+
+	c = d->channel;
+	block = d->multiple > 0 ? d->multiple : 1;
+	lock_acquire (&c->lock);
+	select_sector (d, sec_no, sec_cnt);
+	issue_pio_command (c, d->multiple > 0
+			? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+	for (left = sec_cnt; left > 0; ) {
+		size_t n = left < block ? left : block;
+		sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+		for (size_t i = 0; i < n; i++, p += DISK_SECTOR_SIZE)
+			input_sector (c, p);
+		left -= n;
+	}
+	d->read_cnt += sec_cnt;
+	d->cmd_cnt++;
+	lock_release (&c->lock);
+}
+
+/* Writes SEC_CNT consecutive sectors starting at SEC_NO to disk
+   D from BUFFER, which must contain SEC_CNT * DISK_SECTOR_SIZE
+   bytes, using a single WRITE MULTIPLE (or WRITE SECTOR with a
+   sector count) command.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_multiple (struct disk *d, disk_sector_t sec_no,
+		const void *buffer, size_t sec_cnt) {
+	struct channel *c;
+	const uint8_t *p = buffer;
+	size_t block, left;
+
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (sec_cnt > 0 && sec_cnt < 256);
+
+	c = d->channel;
+	block = d->multiple > 0 ? d->multiple : 1;
+	lock_acquire (&c->lock);
+	select_sector (d, sec_no, sec_cnt);
+	issue_pio_command (c, d->multiple > 0
+			? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY);
+	for (left = sec_cnt; left > 0; ) {
+		size_t n = left < block ? left : block;
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+		for (size_t i = 0; i < n; i++, p += DISK_SECTOR_SIZE)
+			output_sector (c, p);
+		sema_down (&c->completion_wait);
+		left -= n;
+	}
+	d->write_cnt += sec_cnt;
+	d->cmd_cnt++;
 	lock_release (&c->lock);
 }
 
@@ -380,6 +474,34 @@ identify_ata_device (struct disk *d) {
 	printf ("\", serial \"");
 	print_ata_string ((char *) &id[10], 20);
 	printf ("\"\n");
+
+	/* Word 47 bits 7:0 hold the largest DRQ block size supported
+	   by READ/WRITE MULTIPLE, or 0 if they are not supported. */
+	set_multiple_mode (d, id[47] & 0xff);
+}
+
+/* Enables READ/WRITE MULTIPLE on disk D with the largest power of
+   two block size that is at most MAX_MULTIPLE and MULTIPLE_MAX.
+   Leaves D->multiple at 0 if the disk rejects the command. */
+static void
+set_multiple_mode (struct disk *d, int max_multiple) {
+	struct channel *c = d->channel;
+	int multiple = 1;
+
+	if (max_multiple <= 1)
+		return;
+	while (multiple * 2 <= max_multiple && multiple * 2 <= MULTIPLE_MAX)
+		multiple *= 2;
+
+	select_device_wait (d);
+	outb (reg_nsect (c), multiple);
+	issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+	sema_down (&c->completion_wait);
+	wait_while_busy (d);
+	if (inb (reg_status (c)) & STA_ERR)
+		return;
+
+	d->multiple = multiple;
 }
 
 /* Prints STRING, which consists of SIZE bytes in a funky format:
@@ -402,17 +524,17 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and SEC_CNT to the disk's sector selection
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t sec_cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (sec_no + sec_cnt <= d->capacity);
+	ASSERT (sec_no + sec_cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), sec_cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,31 +18,62 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency divided by TIMER_FREQ, rounded to
+   nearest: the PIT counts this many times per tick. */
+#define PIT_COUNT ((1193180 + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot, in ticks, that fits the 16-bit counter. */
+#define ONESHOT_MAX_TICKS (UINT16_MAX / PIT_COUNT)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Number of timer interrupts since OS booted. */
+static int64_t interrupts;
+
+/* -tickless: stop the periodic tick while the CPU is idle? */
+bool timer_tickless;
+
+/* While nonzero, the PIT is in one-shot mode and will interrupt
+   after this many ticks instead of after every tick. */
+static int64_t oneshot_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Nanoseconds per second and per timer tick. */
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* Ticks over which timer_calibrate() measures the TSC rate. */
+#define TSC_CALIBRATE_TICKS 10
+
+/* TSC clock source, set up by timer_calibrate().  TSC_HZ is 0
+   until then, or if the CPU has no TSC, and timer_now_ns() falls
+   back to the tick count. */
+static uint64_t tsc_hz;	  /* TSC increments per second. */
+static uint64_t tsc_base; /* TSC value at tick TSC_BASE_TICK. */
+static int64_t tsc_base_tick;
+
 static intr_handler_func timer_interrupt;
+static void timer_tick(void);
+static void pit_periodic(void);
+static void pit_oneshot(uint16_t count);
+static uint16_t pit_read(bool *expired);
+static bool pit_irq_pending(void);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
+static void tsc_calibrate(void);
+static uint64_t tsc_to_ns(uint64_t cycles);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void timer_init(void)
 {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb(0x40, count & 0xff);
-	outb(0x40, count >> 8);
-
+	pit_periodic();
 	intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -69,6 +101,20 @@ void timer_calibrate(void)
 			loops_per_tick |= test_bit;
 
 	printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+	tsc_calibrate();
+}
+
+/* Returns the time since the OS booted, in nanoseconds.  Uses the
+   TSC once timer_calibrate() has measured it, so the result is
+   much finer than a tick; before that, or without a TSC, it is a
+   multiple of the tick length. */
+int64_t
+timer_now_ns(void)
+{
+	if (tsc_hz == 0)
+		return timer_ticks() * NS_PER_TICK;
+	return tsc_base_tick * NS_PER_TICK + tsc_to_ns(rdtsc() - tsc_base);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -139,13 +185,108 @@ void timer_nsleep(int64_t ns)
 /* Prints timer statistics. */
 void timer_print_stats(void)
 {
-	printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+	printf("Timer: %" PRId64 " ticks, %" PRId64 " interrupts\n", timer_ticks(), interrupts);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In -tickless mode, switches the PIT to one-shot mode so
+   that the next interrupt comes at the earliest sleeper's wakeup
+   tick instead of at the next tick.  The one-shot ends on a tick
+   boundary, so the periodic phase is kept.
+
+   The 16-bit counter limits a one-shot to ONESHOT_MAX_TICKS ticks
+   (5 at 100 Hz); a longer idle period takes several. */
+void timer_idle_enter(void)
+{
+	int64_t cnt;
+	uint16_t left;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	// 앞의 one-shot이 아직 끝나지 않았으면 그대로 둔다.
+	if (!timer_tickless || oneshot_ticks != 0)
+		return;
+
+	cnt = thread_next_wakeup() - ticks;
+	if (cnt > ONESHOT_MAX_TICKS)
+		cnt = ONESHOT_MAX_TICKS;
+	if (cnt < 2)
+		return;
+
+	/* Counts left until the next tick.  If that tick has already
+	   raised its interrupt, take it first. */
+	left = pit_read(NULL);
+	if (pit_irq_pending())
+		return;
+
+	pit_oneshot(left + (cnt - 1) * PIT_COUNT);
+	oneshot_ticks = cnt;
+}
+
+/* Called with interrupts off whenever the idle thread gives up
+   the CPU.  Catches TICKS up with the ticks that have passed
+   since timer_idle_enter(), running their bookkeeping, and arms
+   the PIT to interrupt at the next tick boundary, from where it
+   goes back to periodic mode. */
+void timer_idle_exit(void)
+{
+	bool expired;
+	uint16_t left;
+	int64_t ahead;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (oneshot_ticks == 0)
+		return;
+
+	// 이미 끝났으면 기다리고 있는 인터럽트가 나머지를 처리한다.
+	left = pit_read(&expired);
+	if (expired || left == 0)
+		return;
+
+	// 남은 카운트로 아직 오지 않은 tick 수를 알 수 있다.
+	ahead = DIV_ROUND_UP(left, PIT_COUNT);
+	while (oneshot_ticks > ahead)
+	{
+		oneshot_ticks--;
+		timer_tick();
+	}
+	if (ahead > 1)
+		pit_oneshot((left - 1) % PIT_COUNT + 1);
+	oneshot_ticks = 1;
 }
 
 /* Timer interrupt handler. */
-// PROJECT1 수정해야할 부분
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
+{
+	interrupts++;
+
+	// one-shot이 끝났으면 건너뛴 tick들을 처리하고 주기 모드로 돌아간다.
+	if (oneshot_ticks > 0)
+	{
+		bool expired;
+		pit_read(&expired);
+		if (!expired && oneshot_ticks > 1)
+		{
+			/* A periodic interrupt raised just as timer_idle_enter()
+			   switched modes.  It is the first of the one-shot's
+			   ticks. */
+			oneshot_ticks--;
+			timer_tick();
+			return;
+		}
+		while (--oneshot_ticks > 0)
+			timer_tick();
+		pit_periodic();
+	}
+	timer_tick();
+}
+
+/* Runs the bookkeeping for one timer tick. */
+// PROJECT1 수정해야할 부분
+static void
+timer_tick(void)
 {
 	ticks++;
 	thread_tick(); // update the cpu usage for running process
@@ -169,10 +310,56 @@ timer_interrupt(struct intr_frame *args UNUSED)
 		}
 	}
 
-	// 깨어날 스레드가 있다면 sleep_list에서 ready_list로 삽입
+	// 깨어날 스레드가 있다면 수면 힙에서 ready 큐로 삽입
 	thread_wakeup(ticks); // 일어나야할 시간을 인수로 넘겨줌
 }
 
+/* Puts the PIT in periodic mode, interrupting every tick. */
+static void
+pit_periodic(void)
+{
+	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb(0x40, PIT_COUNT & 0xff);
+	outb(0x40, PIT_COUNT >> 8);
+}
+
+/* Puts the PIT in one-shot mode, interrupting once after COUNT
+   input clocks. */
+static void
+pit_oneshot(uint16_t count)
+{
+	ASSERT(count > 0);
+
+	outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+}
+
+/* Returns the current count of PIT counter 0.  If EXPIRED is
+   nonnull, sets it to whether the counter's output is high, which
+   in one-shot mode means that it has reached zero. */
+static uint16_t
+pit_read(bool *expired)
+{
+	uint8_t status, lo, hi;
+
+	outb(0x43, 0xc2); /* Read-back: latch status and count of counter 0. */
+	status = inb(0x40);
+	lo = inb(0x40);
+	hi = inb(0x40);
+	if (expired != NULL)
+		*expired = (status & 0x80) != 0;
+	return lo | (hi << 8);
+}
+
+/* Returns true if the master PIC has a timer interrupt waiting. */
+static bool
+pit_irq_pending(void)
+{
+	outb(0x20, 0x0a); /* OCW3: read the interrupt request register. */
+	return (inb(0x20) & 0x01) != 0;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -226,6 +413,15 @@ real_time_sleep(int64_t num, int32_t denom)
 		   processes. */
 		timer_sleep(ticks);
 	}
+	else if (tsc_hz != 0)
+	{
+		/* Otherwise spin for sub-tick timing, on the TSC if we
+		   have one.  NUM / DENOM is under a tick, so NUM * TSC_HZ
+		   does not overflow. */
+		uint64_t end = rdtsc() + (uint64_t)num * tsc_hz / denom;
+		while (rdtsc() < end)
+			barrier();
+	}
 	else
 	{
 		/* Otherwise, use a busy-wait loop for more accurate
@@ -235,3 +431,39 @@ real_time_sleep(int64_t num, int32_t denom)
 		busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
 }
+
+/* Measures the TSC rate against the PIT over TSC_CALIBRATE_TICKS
+   ticks, starting and ending on tick boundaries. */
+static void
+tsc_calibrate(void)
+{
+	uint32_t a, b, c, d;
+	uint64_t start;
+	int64_t tick;
+
+	/* CPUID leaf 1, EDX bit 4: the CPU has a TSC. */
+	cpuid(1, &a, &b, &c, &d);
+	if ((d & (1 << 4)) == 0)
+		return;
+
+	tick = ticks;
+	while (ticks == tick)
+		barrier();
+	start = rdtsc();
+	tick = ticks;
+	while (ticks < tick + TSC_CALIBRATE_TICKS)
+		barrier();
+
+	tsc_base = rdtsc();
+	tsc_base_tick = ticks;
+	tsc_hz = (tsc_base - start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+	printf("TSC: %'" PRIu64 " Hz.\n", tsc_hz);
+}
+
+/* Converts CYCLES of the TSC to nanoseconds, without overflowing
+   for any CPU under about 9 GHz. */
+static uint64_t
+tsc_to_ns(uint64_t cycles)
+{
+	return cycles / tsc_hz * NS_PER_SEC + cycles % tsc_hz * NS_PER_SEC / tsc_hz;
+}
@@ -1,9 +1,198 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include "filesys/page_cache.h"
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
+
+tid_t page_cache_workerd;
+
+#ifdef VM
+/* Page cache of mapped file data.
+ *
+ * Every frame that holds file contents for a user mapping (mmap pages and
+ * read-only executable pages) is registered here under (inode, page offset),
+ * so that all processes mapping the same file page share one frame.
+ * inode_read_at() and inode_write_at() consult the cache as well: a read of
+ * a mapped page is served from memory, and a write keeps the mapped copy
+ * coherent.  A frame stays cached while at least one page maps it.
+ *
+ * The cache is protected by vm_lock, like the frame table.  Readers and
+ * writers of file data hold filesys_lock as well and take vm_lock after
+ * it; the fault path may already hold both. */
+
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
+#include "userprog/process.h"
+
+/* Ticks between two writebacks of dirty mapped pages. */
+#define PAGE_CACHE_FLUSH_INTERVAL (TIMER_FREQ * 5)
+
+static struct hash page_cache;
+
+/* False until vm_init(): the file system reads the free map first. */
+static bool page_cache_ready;
+
+static uint64_t page_cache_hash (const struct hash_elem *, void *);
+static bool page_cache_less (const struct hash_elem *,
+		const struct hash_elem *, void *);
+
+/* Initializes the page cache and starts its writeback daemon. */
+void
+page_cache_init (void) {
+	hash_init (&page_cache, page_cache_hash, page_cache_less, NULL);
+	page_cache_ready = true;
+	page_cache_workerd = thread_create ("kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+}
+
+/* Returns the cached frame for byte OFS of INODE, or NULL. */
+struct frame *
+page_cache_lookup (struct inode *inode, off_t ofs) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.inode = inode;
+	key.ofs = ofs & ~PGMASK;
+	e = hash_find (&page_cache, &key.cache_elem);
+	return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* Registers FRAME as holding READ_BYTES bytes of INODE starting at page
+ * offset OFS.  The frame keeps its own reference to INODE. */
+void
+page_cache_insert (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes) {
+	ASSERT (frame->inode == NULL);
+	ASSERT (pg_ofs (ofs) == 0);
+
+	frame->inode = inode_reopen (inode);
+	frame->ofs = ofs;
+	frame->read_bytes = read_bytes;
+	hash_insert (&page_cache, &frame->cache_elem);
+}
+
+/* Drops FRAME from the cache.  The caller writes it back first. */
+void
+page_cache_remove (struct frame *frame) {
+	ASSERT (frame->inode != NULL);
+
+	hash_delete (&page_cache, &frame->cache_elem);
+	inode_close (frame->inode);
+	frame->inode = NULL;
+}
+
+/* Writes FRAME back to its file if any mapping has dirtied it, and marks
+ * every mapping clean again. */
+void
+page_cache_flush (struct frame *frame) {
+	bool dirty = false;
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (pml4_is_dirty (page->thread->pml4, page->va)) {
+			pml4_set_dirty (page->thread->pml4, page->va, false);
+			dirty = true;
+		}
+	}
+	if (dirty)
+		inode_write_at (frame->inode, frame->kva, frame->read_bytes, frame->ofs);
+}
+
+/* Copies SIZE bytes at OFS of INODE into BUFFER if a cached frame holds
+ * them, and returns true.  The range must lie within one disk sector, as
+ * inode_read_at() hands it over.  A kernel BUFFER is filled directly; a
+ * user BUFFER is staged on the stack first, since faulting on it may evict
+ * the frame. */
+bool
+page_cache_read (struct inode *inode, off_t ofs, void *buffer, size_t size) {
+	uint8_t staged[DISK_SECTOR_SIZE];
+	bool user = is_user_vaddr (buffer);
+	struct frame *frame;
+	bool hit = false;
+	int held;
+
+	ASSERT (size <= DISK_SECTOR_SIZE);
+
+	if (!page_cache_ready)
+		return false;
+
+	held = vm_lock_acquire (false);
+	frame = page_cache_lookup (inode, ofs);
+	if (frame != NULL && pg_ofs (ofs) + size <= frame->read_bytes) {
+		memcpy (user ? staged : buffer, frame->kva + pg_ofs (ofs), size);
+		hit = true;
+	}
+	vm_lock_release (held);
+
+	if (hit && user)
+		memcpy (buffer, staged, size);
+	return hit;
+}
+
+/* Updates the cached copy of SIZE bytes at OFS of INODE, if there is one,
+ * with BUFFER.  The range must lie within one disk sector. */
+void
+page_cache_write (struct inode *inode, off_t ofs, const void *buffer,
+		size_t size) {
+	uint8_t staged[DISK_SECTOR_SIZE];
+	struct frame *frame;
+	int held;
+
+	ASSERT (size <= DISK_SECTOR_SIZE);
+
+	if (!page_cache_ready)
+		return;
+
+	held = vm_lock_acquire (false);
+	frame = page_cache_lookup (inode, ofs);
+	/* Nothing cached, or writeback of the frame itself. */
+	if (frame == NULL || pg_ofs (ofs) >= frame->read_bytes
+			|| buffer == frame->kva + pg_ofs (ofs)) {
+		vm_lock_release (held);
+		return;
+	}
+	vm_lock_release (held);
+
+	/* BUFFER may be a user address, so copy it outside vm_lock. */
+	memcpy (staged, buffer, size);
+
+	/* Copying from BUFFER may have evicted the frame. */
+	held = vm_lock_acquire (false);
+	frame = page_cache_lookup (inode, ofs);
+	if (frame != NULL && pg_ofs (ofs) < frame->read_bytes) {
+		if (pg_ofs (ofs) + size > frame->read_bytes)
+			size = frame->read_bytes - pg_ofs (ofs);
+		memcpy (frame->kva + pg_ofs (ofs), staged, size);
+	}
+	vm_lock_release (held);
+}
+
+static uint64_t
+page_cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *frame = hash_entry (e, struct frame, cache_elem);
+	return hash_bytes (&frame->inode, sizeof frame->inode) ^ hash_int (frame->ofs);
+}
+
+static bool
+page_cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+	const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->ofs < b->ofs;
+}
+#endif
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -13,38 +202,59 @@ static const struct page_operations page_cache_op = {
 	.type = VM_PAGE_CACHE,
 };
 
-tid_t page_cache_workerd;
 
-/* The initializer of file vm */
+/* The initializer of file vm.  The writeback daemon is started by
+ * page_cache_init() together with the cache itself. */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
 }
 
-/* Initialize the page cache */
+/* Initialize the page cache.  Cached file data lives in frames shared by
+ * the pages that map it rather than in VM_PAGE_CACHE pages, so no page is
+ * ever given this type. */
 bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
+page_cache_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &page_cache_op;
-
+	return false;
 }
 
 /* Utilze the Swap in mechanism to implement readhead */
 static bool
-page_cache_readahead (struct page *page, void *kva) {
+page_cache_readahead (struct page *page UNUSED, void *kva UNUSED) {
+	return false;
 }
 
 /* Utilze the Swap out mechanism to implement writeback */
 static bool
-page_cache_writeback (struct page *page) {
+page_cache_writeback (struct page *page UNUSED) {
+	return false;
 }
 
 /* Destory the page_cache. */
 static void
-page_cache_destroy (struct page *page) {
+page_cache_destroy (struct page *page UNUSED) {
 }
 
 /* Worker thread for page cache */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+#ifdef VM
+	/* Periodically write back mapped pages that processes have dirtied, so
+	 * that munmap and eviction rarely find dirty pages. */
+	for (;;) {
+		struct hash_iterator i;
+
+		timer_sleep (PAGE_CACHE_FLUSH_INTERVAL);
+		lock_acquire (&filesys_lock);
+		lock_acquire (&vm_lock);
+		hash_first (&i, &page_cache);
+		while (hash_next (&i))
+			page_cache_flush (hash_entry (hash_cur (&i), struct frame,
+						cache_elem));
+		lock_release (&vm_lock);
+		lock_release (&filesys_lock);
+	}
+#endif
 }
@@ -8,5 +8,21 @@ enum vm_type;
 struct page_cache {};
 
 void page_cache_init (void);
+void pagecache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+#ifdef VM
+/* Frames that map file data (mmap and read-only text pages) are shared
+ * through the page cache, keyed by (inode, page offset). */
+struct inode;
+struct frame;
+struct frame *page_cache_lookup (struct inode *, off_t ofs);
+void page_cache_insert (struct frame *, struct inode *, off_t ofs,
+		size_t read_bytes);
+void page_cache_remove (struct frame *);
+void page_cache_flush (struct frame *);
+bool page_cache_read (struct inode *, off_t ofs, void *buffer, size_t size);
+void page_cache_write (struct inode *, off_t ofs, const void *buffer,
+		size_t size);
+#endif
 #endif
@@ -50,6 +50,38 @@ static __inline uint64_t rcr3(void) {
 	return val;
 }
 
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+/* Loads VAL into CR0.  CR0_WP makes the kernel honor read-only
+   page table entries, so its writes to user memory fault too. */
+#define CR0_WP (1 << 16)
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val));
+}
+
+/* Returns the processor's time-stamp counter. */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Runs CPUID for LEAF and stores the results in *A, *B, *C, *D. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t *a, uint32_t *b,
+		uint32_t *c, uint32_t *d) {
+	__asm __volatile("cpuid"
+			: "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d)
+			: "a" (leaf), "c" (0));
+}
+
 __attribute__((always_inline))
 static __inline uint64_t rrax(void) {
 	uint64_t val;
@@ -37,6 +37,18 @@ enum
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	SYS_CLOCK_GETTIME, /* Read a clock, in nanoseconds. */
+	SYS_CLOCK_NANOSLEEP, /* Sleep for a number of nanoseconds. */
 };
 
+/* Flags for the WRITABLE argument of SYS_MMAP.  Plain true/false
+   still means a read-only or writable file mapping. */
+#define MAP_WRITE 0x1	  /* Pages are writable. */
+#define MAP_ANONYMOUS 0x2 /* Zero-filled memory, no file; FD and OFFSET are ignored. */
+#define MAP_SHARED 0x4	  /* With MAP_ANONYMOUS: forked children share the same pages. */
+
+/* Clocks for SYS_CLOCK_GETTIME and SYS_CLOCK_NANOSLEEP. */
+#define CLOCK_MONOTONIC 1 /* Time since boot; never goes backward. */
+
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -16,6 +18,13 @@ typedef int off_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* A time, as read by clock_gettime(). */
+struct timespec
+{
+	int64_t tv_sec; /* Seconds. */
+	long tv_nsec;	/* Nanoseconds, 0 to 999,999,999. */
+};
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0 /* Successful execution. */
 #define EXIT_FAILURE 1 /* Unsuccessful execution. */
@@ -37,6 +46,8 @@ unsigned tell(int fd);
 void close(int fd);
 
 int dup2(int oldfd, int newfd);
+int clock_gettime(int clock_id, struct timespec *ts);
+int clock_nanosleep(int clock_id, const struct timespec *req);
 
 /* Project 3 and optionally project 4. */
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
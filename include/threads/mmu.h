@@ -16,6 +16,10 @@
 										  Virtual Address
 */
 
+/* A page directory entry with PTE_PS maps one 2 MB (huge) page. */
+#define HUGE_PGSIZE (1UL << PDXSHIFT)
+#define HUGE_PGCNT (HUGE_PGSIZE / PGSIZE)
+
 typedef bool pte_for_each_func(uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk(uint64_t *pml4, const uint64_t va, int create);
@@ -30,6 +34,8 @@ bool pml4_is_dirty(uint64_t *pml4, const void *upage);
 void pml4_set_dirty(uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed(uint64_t *pml4, const void *upage);
 void pml4_set_accessed(uint64_t *pml4, const void *upage, bool accessed);
+bool pml4_set_huge_page(uint64_t *pml4, void *upage, void *kpage, bool rw);
+bool pml4_is_huge(uint64_t *pml4, const void *upage);
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
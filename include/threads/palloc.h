@@ -21,4 +21,10 @@ void *palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void *);
 void palloc_free_multiple(void *, size_t page_cnt);
 
+size_t palloc_user_page_cnt(void);
+size_t palloc_user_free_cnt(void);
+size_t palloc_user_page_idx(void *page);
+void *palloc_user_page(size_t idx);
+void *palloc_get_aligned(enum palloc_flags, size_t page_cnt);
+
 #endif /* threads/palloc.h */
@@ -0,0 +1,39 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Object cache for fixed-size kernel objects.  Each cache carves
+ * whole pages ("slabs") into objects of a single type, so objects
+ * are packed without power-of-2 rounding and every type has its
+ * own free list and lock. */
+struct slab_cache
+{
+	const char *name;		/* Name for statistics. */
+	size_t obj_size;		/* Object size, rounded for alignment. */
+	size_t objs_per_slab;	/* Objects in one slab page. */
+	void (*ctor)(void *);	/* Constructor, may be null. */
+	struct list partial;	/* Slabs with at least one free object. */
+	struct lock lock;		/* Protects the cache. */
+	struct list_elem elem;	/* Element in the list of all caches. */
+
+	/* Statistics. */
+	uint64_t alloc_cnt;		/* Objects handed out. */
+	uint64_t free_cnt;		/* Objects given back. */
+	uint64_t grow_cnt;		/* Allocations that needed a new slab. */
+	size_t in_use;			/* Objects currently allocated. */
+	size_t peak;			/* Highest IN_USE seen. */
+	size_t slab_cnt;		/* Slab pages currently held. */
+};
+
+void slab_init(void);
+void slab_cache_init(struct slab_cache *, const char *name, size_t size,
+					 void (*ctor)(void *));
+void *slab_alloc(struct slab_cache *) __attribute__((malloc));
+void slab_free(struct slab_cache *, void *);
+void slab_print_stats(void);
+
+#endif /* threads/slab.h */
@@ -155,6 +155,9 @@ struct thread
 	/* 4BSD */
 	int nice;
 	int recent_cpu;
+	int64_t mlfqs_epoch;		 // recent_cpu에 반영된 초 단위 감쇠 횟수
+	bool mlfqs_dirty;			 // 우선순위를 다시 계산해야 하는지 (mlfqs_dirty 리스트에 있음)
+	struct list_elem mlfqs_elem; // mlfqs_dirty 리스트 element
 
 	/* project 2 system call */
 	struct intr_frame parent_if; /* 부모 프로세스의 인터럽트 프레임 */ // _fork() 구현 때 사용, __do_fork() 함수
@@ -184,6 +187,7 @@ struct thread
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	bool oom_killed; // OOM killer에게 선택됨. 더 이상 프레임을 받지 못하고 exit(-1)로 끝난다.
 #endif
 
 	/* Owned by thread.c. */
@@ -215,6 +219,10 @@ const char *thread_name(void);
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func(struct thread *t, void *aux);
+void thread_foreach(thread_action_func *, void *);
+
 int thread_get_priority(void);
 void thread_set_priority(int);
 
@@ -227,20 +235,21 @@ void do_iret(struct intr_frame *tf);
 
 void thread_sleep(int64_t wakeup_ticks);
 void thread_wakeup(int64_t wakeup_ticks);
+int64_t thread_next_wakeup(void);
 
-bool compare_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 bool compare_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 // bool compare_donate_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED); // 그냥 compare_priority 써도 무방
 
 void preemption_priority(void);
 void refresh_priority(void);
+void thread_update_priority(struct thread *t, int priority);
 
 void donate_priority(void);
 void remove_donation(struct lock *lock);
 
 /* 4BSD */
 void mlfqs_calculate_priority(struct thread *t);
-void mlfqs_calculate_recent_cpu(struct thread *t);
+void mlfqs_catch_up(struct thread *t);
 void mlfqs_calculate_load_avg(void);
 void mlfqs_increase_recent_cpu(void);
 void mlfqs_recalculate_priority(void);
@@ -6,6 +6,16 @@
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+/* Emits an entry of the exception fixup table, for use inside
+   inline assembly.  If the instruction at label INSN takes a
+   page fault that the VM cannot resolve, the page fault handler
+   resumes at label FIXUP instead of killing the process. */
+#define EXCEPTION_FIXUP(INSN, FIXUP)            \
+	".pushsection .ex_table, \"a\"\n\t"        \
+	".balign 8\n\t"                             \
+	".quad " #INSN ", " #FIXUP "\n\t"            \
+	".popsection\n\t"
+
 void exception_init (void);
 void exception_print_stats (void);
 
@@ -6,5 +6,6 @@ typedef int pid_t;
 #define PID_ERROR ((pid_t) - 1)
 
 void syscall_init(void);
+void exit(int status);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,12 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+bool user_range_ok (const void *uaddr, size_t size);
+size_t copy_from_user (void *dst, const void *usrc, size_t size);
+size_t copy_to_user (void *udst, const void *src, size_t size);
+long strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+#endif /* userprog/uaccess.h */
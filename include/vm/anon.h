@@ -1,6 +1,7 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
 #include "vm/vm.h"
+#include "threads/vaddr.h"
 struct page;
 enum vm_type;
 
@@ -16,11 +17,34 @@ struct anon_page
 
 void vm_anon_init(void);
 bool anon_initializer(struct page *page, enum vm_type type, void *kva);
+bool anon_swap_to_disk(struct page *page, const void *kva);
+void anon_share_slot(struct page *page, size_t sw_idx);
+void anon_forget_slot(struct page *page);
+size_t anon_swap_write(const void *kva);
+void anon_swap_read(size_t sw_idx, void *kva);
+void anon_swap_free(size_t sw_idx);
+void *do_mmap_anon(void *addr, size_t length, bool writable, bool shared);
+
+// 한 페이지(스왑 슬롯 하나)를 담는 데 필요한 섹터 수
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+// 슬롯 첫 섹터 번호를 슬롯 번호로 바꾼다.
+#define SWAP_SLOT(sw_idx) ((sw_idx) / SECTORS_PER_PAGE)
+
+// 프로세스마다 새 슬롯 묶음을 이만큼(페이지 수) 이어서 잡는다.
+#define SWAP_CLUSTER 16
+
+// 스왑인할 때 디스크에서 함께 읽을 최대 페이지 수 (폴트 난 페이지 포함)
+#define SWAP_READAHEAD 8
 
 // 스왑테이블 선언
 struct swap_table
 {
     struct bitmap *sb;
+    size_t slot_cnt; // 전체 슬롯(페이지) 수
+    size_t used_cnt; // 쓰고 있는 슬롯 수
+    size_t hint;     // 다음 빈 묶음을 찾기 시작할 섹터
+    uint16_t *refs;  // 슬롯마다 그 슬롯을 가리키는 페이지 수
 };
 
 #endif
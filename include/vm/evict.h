@@ -0,0 +1,30 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+struct page;
+
+/* 페이지 교체 정책. frame table에서 쫓아낼 프레임을 고르고, 프레임이 쓰이기 시작하거나
+ * 비워지거나 폴트로 접근될 때 알림을 받는다. 모든 함수는 vm_lock을 잡고 불린다.
+ * 커널 커맨드라인 옵션 "-evict=NAME"으로 고른다. */
+struct evict_policy
+{
+	const char *name;
+	void (*init)(size_t frame_cnt);
+	struct frame *(*victim)(void);						  // 쫓아낼 프레임, 없으면 NULL
+	void (*add)(struct frame *frame);					  // 빈 프레임이 쓰이기 시작함
+	void (*remove)(struct frame *frame, struct page *evicted); // 프레임이 비워짐, 쫓겨났으면 그 페이지
+	void (*access)(struct frame *frame, struct page *page); // PAGE의 폴트가 FRAME으로 해결됨
+};
+
+extern const struct evict_policy *evict_policy;
+bool evict_policy_select(const char *name);
+
+// 정책이 후보를 살필 때 쓰는 frame table 도우미 (vm.c)
+bool frame_evictable(struct frame *frame);
+bool frame_test_and_clear_accessed(struct frame *frame);
+bool frame_is_clean(struct frame *frame);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stdint.h>
+
+/* ksmd: 우선순위가 낮은 커널 스레드가 frame table의 익명 프레임 내용을 해시해서
+ * 같은 내용의 페이지들을 읽기 전용 프레임 하나로 합친다. 공유는 다음 쓰기 폴트에서 깨진다. */
+struct ksm_stats
+{
+	uint64_t scanned;  // 살펴본 프레임 수
+	uint64_t merged;   // 다른 프레임으로 합쳐서 해제한 페이지 수
+	uint64_t unmerged; // 합친 프레임에 쓰기가 나서 다시 복사한 페이지 수
+};
+extern struct ksm_stats ksm_stats;
+
+void ksm_init(void);
+void ksm_print_stats(void);
+
+#endif
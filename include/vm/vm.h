@@ -1,12 +1,12 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <stdint.h>
 #include "threads/palloc.h"
 #include "include/lib/kernel/hash.h"
 #include "devices/disk.h"
-
-// frame table : 원형 리스트
-struct list frame_table;
+#include "filesys/off_t.h"
+#include "threads/synch.h"
 
 enum vm_type
 {
@@ -26,6 +26,10 @@ enum vm_type
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 	VM_STACK = (1 << 5), // 스택 페이지를 나타내는 마커 추가
+	VM_ZERO = (1 << 6),	 // 첫 쓰기 전까지 공유 zero page로 읽을 수 있는 익명 페이지 (스택, BSS)
+	VM_TEXT = (1 << 7),	 // 읽기 전용 실행 파일 페이지, page cache로 프로세스 간 공유
+	VM_MMAP = (1 << 8),	 // mmap(MAP_ANONYMOUS)으로 만든 익명 영역, munmap할 수 있다
+	VM_SHARED = (1 << 9), // fork 후에도 부모와 자식이 같은 프레임을 쓰는 공유 익명 영역
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
@@ -33,6 +37,10 @@ enum vm_type
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/zswap.h"
+#include "vm/ksm.h"
+#include "vm/evict.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -45,6 +53,46 @@ struct thread;
 /*------project3 vm ---------*/
 #define USER_STACK_LIMIT (1 << 20) // 스택 제한 크기 1MB
 
+// kswapd가 유지할 user pool 여유 프레임 수. 0이면 프레임 수로부터 기본값을 정함.
+// 커널 커맨드라인 옵션 "-kswapd-low", "-kswapd-high"로 설정.
+extern size_t kswapd_low_wmark;
+extern size_t kswapd_high_wmark;
+
+// 파일 페이지 폴트 한 번에 함께 적재할 최대 페이지 수. 0이나 1이면 fault-around를 끔.
+// 커널 커맨드라인 옵션 "-fault-around"로 설정.
+#define FAULT_AROUND_INIT 4	  // 순차 접근이 아닐 때의 윈도우 크기
+#define FAULT_AROUND_DEFAULT 16 // fault_around_max 기본값 (64KB)
+extern size_t fault_around_max;
+
+// 2MB로 정렬된 익명 영역이 모두 올라오면 PDE 하나(huge page)로 매핑한다.
+// 커널 커맨드라인 옵션 "-no-huge"로 끔.
+extern bool vm_huge_pages;
+
+// 압축 스왑 캐시 한도 (페이지 수). 0이면 끄고, ZSWAP_AUTO면 user pool의 1/4.
+// 커널 커맨드라인 옵션 "-zswap"으로 설정.
+#define ZSWAP_AUTO ((size_t)-1)
+extern size_t zswap_max_pages;
+
+// ksmd: 내용이 같은 익명 페이지를 읽기 전용 프레임 하나로 합친다.
+// 커널 커맨드라인 옵션 "-ksm"으로 켬.
+extern bool vm_ksm;
+
+// 교체와 스왑 통계. 종료할 때 vm_print_stats로 출력한다.
+struct vm_stats
+{
+	uint64_t evict_cnt;	   // 쫓아낸 프레임 수
+	uint64_t swap_out_cnt; // 스왑 디스크에 쓴 페이지 수
+	uint64_t swap_in_cnt;  // 스왑 디스크에서 읽은 페이지 수
+};
+extern struct vm_stats vm_stats;
+
+/* frame table, 스왑, 압축 스왑 캐시, page cache, 공유 영역, ksmd, 교체 정책을 지키는 락.
+ * 파일 내용은 filesys_lock이 지킨다. 둘 다 잡을 때는 filesys_lock을 먼저 잡는다.
+ * vm_lock_acquire는 새로 잡은 락을 돌려주고, vm_lock_release에 그대로 넘긴다. */
+extern struct lock vm_lock;
+int vm_lock_acquire(bool file);
+void vm_lock_release(int held);
+
 /*-------------------------------*/
 
 /* The representation of "page".
@@ -61,11 +109,15 @@ struct page
 	/*------- project3 추가 -------------------------------------*/
 	bool writable;				 // true일경우 해당 주소에 write 가능
 	bool is_loaded;				 // 물리메모리의 탑재 여부를 알려주는 플래그
-	void *start_address;		 // mmap 시작주소 저장용
+	struct vm_area *vma;		 // 이 페이지가 속한 영역
+	struct list_elem vma_elem;	 // 영역의 페이지 리스트 element
 	struct hash_elem hash_elem;	 // 해시테이블 element
-	struct list_elem frame_elem; // 프레임테이블 element
+	struct list_elem frame_elem; // 같은 프레임을 매핑한 페이지 리스트 element
 	struct thread *thread;		 // 해당 물리 페이지를 사용중인 스레드 포인터
 	size_t sw_idx;				 // 스왑슬롯 인덱스 변수
+	bool sw_valid;				 // sw_idx 슬롯에 이 페이지의 내용이 있음 (스왑인 후에도 깨끗한 동안 유지)
+	struct zswap_entry *zswap;	 // 압축 스왑 캐시에 있으면 그 항목, 아니면 NULL
+	bool ksm;					 // ksmd가 같은 내용의 다른 페이지와 한 프레임으로 합쳤음
 
 	/*--------------------------------------------------------------*/
 
@@ -89,13 +141,43 @@ struct frame
 	struct page *page; // 페이지 구조체를 담기 위한 멤버
 
 	/* ------------ project3 vm 멤버 추가----------------*/
+	uint64_t *pml4;	   // 소유자(page)의 pml4, accessed/dirty 비트는 여기서 확인
+	int cnt;		   // 이 프레임을 공유하는 페이지 수 (copy-on-write)
+	int pin_cnt;	   // 커널이 유저 버퍼로 쓰고 있는 횟수. 0이 아니면 쫓아내거나 옮기지 않는다.
+	struct list pages; // 이 프레임을 매핑한 페이지들, 맨 앞이 소유자
 
-	// struct thread *thread;		// 해당 물리 페이지를 사용중인 스레드 포인터
-	struct list_elem frame_elem; // list 연결을 위한 필드
+	// 파일 데이터를 담은 프레임의 page cache 키. inode가 NULL이면 page cache에 없는 프레임
+	struct inode *inode;		 // 캐시한 파일 (참조를 가짐)
+	off_t ofs;					 // 페이지 단위로 정렬된 파일 오프셋
+	size_t read_bytes;			 // 파일에서 읽은 바이트 수, 나머지는 0
+	struct hash_elem cache_elem; // page cache 해시 원소
+
+	// 공유 익명 영역의 페이지를 담은 프레임이면 그 영역의 공유 객체와 페이지 번호
+	struct vm_shm *shm;
+	size_t shm_idx;
+
+	// 교체 정책이 쓰는 상태 (vm/evict.c)
+	struct list_elem evict_elem; // 정책의 리스트 element
+	uint8_t age;				 // lru: 최근 참조 이력, 클수록 최근
+	uint8_t evict_list;			 // car: 들어 있는 리스트
 
 	/*---------------------------------------------------*/
 };
 
+/* 공유 익명 영역(MAP_SHARED)의 페이지들. fork로 복사된 영역들이 함께 참조하며,
+ * 각 페이지는 프레임에 있거나 스왑 슬롯에 있거나 아직 만들어지지 않았다(0).
+ * 프레임은 매핑한 프로세스가 없어도 객체가 가지고 있다가 마지막 영역이 없어질 때 놓는다. */
+struct vm_shm
+{
+	int ref;		  // 이 객체를 쓰는 영역 수
+	size_t page_cnt;  // 페이지 수
+	struct vm_shm_slot
+	{
+		struct frame *frame; // 올라와 있으면 그 프레임
+		size_t sw_idx;		 // 쫓겨났으면 스왑 슬롯의 첫 섹터, 아니면 SIZE_MAX
+	} slots[];
+};
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -119,7 +201,23 @@ struct page_operations
  * All designs up to you for this. */
 struct supplemental_page_table
 {
-	struct hash hash_table; // 해시테이블 선언
+	struct hash hash_table; // 해시테이블 선언, 이미 만들어진 페이지만 들어 있다.
+
+	// 주소 공간의 영역들. 페이지는 영역 안에서 처음 폴트가 날 때 만들어 hash_table에 넣는다.
+	struct vm_area *vma_root;  // 시작 주소로 정렬된 AVL 트리의 루트
+	struct vm_area *vma_cache; // 마지막으로 찾은 영역
+
+	// fault-around: 지난 윈도우 바로 다음 주소에서 폴트가 나면 순차 접근으로 보고 윈도우를 키운다.
+	void *fault_around_next;	// 지난 윈도우가 끝난 주소
+	size_t fault_around_window; // 현재 윈도우 크기 (페이지 수)
+
+	// 스왑 묶음: 지난번에 디스크로 내보낸 페이지 바로 옆 페이지는 바로 옆 슬롯에 쓴다.
+	void *swap_next_va;	  // 이어서 쓸 가상 주소
+	size_t swap_next_idx; // 그 주소에 쓸 슬롯의 첫 섹터
+
+	// 메모리 사용량. OOM killer가 가장 많이 쓰는 프로세스를 고를 때 본다.
+	size_t rss;		 // 매핑된 프레임 수 (zero page 제외, 공유 프레임은 공유자마다 셈)
+	size_t swap_cnt; // 압축 스왑 캐시나 스왑 디스크에 내려간 페이지 수
 };
 
 #include "threads/thread.h"
@@ -129,10 +227,12 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst,
 void supplemental_page_table_kill(struct supplemental_page_table *spt);
 struct page *spt_find_page(struct supplemental_page_table *spt,
 						   void *va);
+struct page *spt_get_page(struct supplemental_page_table *spt, void *va);
 bool spt_insert_page(struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page);
 
 void vm_init(void);
+void vm_print_stats(void);
 bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user,
 						 bool write, bool not_present);
 
@@ -141,7 +241,17 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 									bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page(struct page *page);
+void *vm_load_info_alloc(void);
+void vm_load_info_free(void *info);
 bool vm_claim_page(void *va);
+bool vm_pin_range(const void *uaddr, size_t size, bool write);
+struct vm_shm *vm_shm_create(size_t page_cnt);
+void vm_shm_put(struct vm_shm *shm);
+void vm_unpin_range(const void *uaddr, size_t size);
+size_t vm_frame_cnt(void);
+struct frame *vm_frame_at(size_t idx);
+struct frame *vm_zero_frame(void);
+void vm_frame_merge(struct frame *to, struct page *page);
 enum vm_type page_get_type(struct page *page);
 
 #endif /* VM_VM_H */
@@ -0,0 +1,47 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <list.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+struct supplemental_page_table;
+
+/* 가상 주소 영역(VMA). 실행 파일 세그먼트, mmap, 스택처럼 같은 방식으로 채워지는
+ * 연속된 페이지 범위 하나를 나타낸다. struct page는 범위 안의 주소에서 처음 폴트가
+ * 날 때 만들어지므로, 건드리지 않은 범위는 이 구조체 하나만 차지한다.
+ * 영역들은 겹치지 않으며 시작 주소로 정렬된 AVL 트리에 들어 있다. */
+struct vm_area
+{
+	void *start; // 페이지 정렬된 시작 주소
+	void *end;	 // 페이지 정렬된 끝 주소 (포함하지 않음)
+
+	enum vm_type type;	   // 파일 내용이 있는 페이지의 타입, 파일이 없으면 모든 페이지의 타입
+	bool writable;		   // 쓰기 가능 여부
+	vm_initializer *init;  // 파일 내용을 읽어 들이는 함수
+	struct file *file;	   // 읽어 들일 파일, 없으면 NULL (VM_FILE이면 영역이 소유)
+	off_t offset;		   // start에 대응하는 파일 오프셋
+	size_t read_bytes;	   // start부터 파일에서 읽을 바이트 수, 나머지는 0
+	struct list pages;	   // 이미 만들어진 페이지들 (page->vma_elem)
+	struct vm_shm *shm;	   // VM_SHARED 영역이면 프로세스들이 함께 쓰는 페이지들, 아니면 NULL
+
+	struct vm_area *left;  // AVL 트리 자식
+	struct vm_area *right;
+	int height;			   // 이 노드를 루트로 하는 서브트리의 높이
+};
+
+void vma_init(void);
+struct vm_area *vma_map(struct supplemental_page_table *spt, void *start, size_t length,
+						enum vm_type type, bool writable, vm_initializer *init,
+						struct file *file, off_t offset, size_t read_bytes);
+void vma_unmap(struct supplemental_page_table *spt, struct vm_area *vma);
+struct vm_area *vma_find(struct supplemental_page_table *spt, void *va);
+bool vma_overlaps(struct supplemental_page_table *spt, void *start, void *end);
+void *vma_find_free(struct supplemental_page_table *spt, size_t length, void *top);
+bool vma_grow_down(struct supplemental_page_table *spt, struct vm_area *vma, void *start);
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src);
+void vma_destroy_all(struct supplemental_page_table *spt);
+
+#endif
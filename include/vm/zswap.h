@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+struct zswap_entry;
+
+/* 압축 스왑 캐시: 쫓겨난 익명 페이지를 압축해서 커널 메모리에 두고,
+ * 한도를 넘으면 가장 오래된 항목부터 스왑 디스크로 내려보낸다. */
+void zswap_init(void);
+bool zswap_store(struct page *page, const void *kva);
+void zswap_load(struct page *page, void *kva);
+void zswap_read(const struct page *page, void *kva);
+void zswap_free(struct page *page);
+
+#endif
@@ -146,6 +146,21 @@ int dup2(int oldfd, int newfd)
 	return syscall2(SYS_DUP2, oldfd, newfd);
 }
 
+int clock_gettime(int clock_id, struct timespec *ts)
+{
+	int64_t ns = syscall1(SYS_CLOCK_GETTIME, clock_id);
+	if (ns < 0)
+		return -1;
+	ts->tv_sec = ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+	return 0;
+}
+
+int clock_nanosleep(int clock_id, const struct timespec *req)
+{
+	return syscall2(SYS_CLOCK_NANOSLEEP, clock_id, req->tv_sec * 1000000000 + req->tv_nsec);
+}
+
 void *
 mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 {
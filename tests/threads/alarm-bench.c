@@ -0,0 +1,104 @@
+/* Measures how much the timer interrupt costs as more threads
+   sleep.  For each sleeper count, puts that many threads to
+   sleep until well after the measurement window, then counts
+   how many iterations of a busy loop fit into a tick.  Time
+   spent in the tick handler comes out of the busy loop, so with
+   a sleep queue that looks at every sleeper on each tick the
+   count drops as sleepers are added, and with one that only
+   looks at the earliest deadline it stays flat.
+
+   The counts depend on the host, so the test only reports them.
+   It fails if any sleeper wakes up before its deadline. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks over which to count loop iterations. */
+#define MEASURE_TICKS 50
+
+static const int sleeper_cnts[] = {0, 32, 128, 256};
+
+static struct semaphore done;
+static int early_cnt;
+
+static thread_func sleeper;
+static long long loops_per_tick (void);
+
+void
+test_alarm_bench (void) 
+{
+  long long idle = 0;
+  size_t i;
+  int j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  early_cnt = 0;
+  for (i = 0; i < sizeof sleeper_cnts / sizeof *sleeper_cnts; i++) 
+    {
+      int cnt = sleeper_cnts[i];
+      int64_t wakeup = timer_ticks () + MEASURE_TICKS + 20;
+      long long loops;
+
+      /* The sleepers outrank us, so each one is asleep before
+         thread_create() returns.  Spread their deadlines so they
+         are not all equal. */
+      for (j = 0; j < cnt; j++) 
+        {
+          char name[32];
+          snprintf (name, sizeof name, "sleeper %d", j);
+          thread_create (name, PRI_DEFAULT + 1, sleeper,
+                         (void *) (wakeup + j % 32));
+        }
+
+      loops = loops_per_tick ();
+      if (cnt == 0)
+        idle = loops;
+      msg ("%d sleepers: %lld loops per tick (%lld%% of idle)",
+           cnt, loops, idle != 0 ? loops * 100 / idle : 0);
+
+      for (j = 0; j < cnt; j++)
+        sema_down (&done);
+    }
+  if (early_cnt != 0)
+    fail ("%d sleepers woke up before their deadline", early_cnt);
+  msg ("PASS");
+}
+
+/* Sleeps until the tick given by AUX, checks that the deadline
+   has passed, then reports back. */
+static void
+sleeper (void *wakeup_) 
+{
+  int64_t wakeup = (int64_t) wakeup_;
+
+  timer_sleep (wakeup - timer_ticks ());
+  if (timer_ticks () < wakeup)
+    early_cnt++;
+  sema_up (&done);
+}
+
+/* Spins for MEASURE_TICKS ticks and returns the average number
+   of iterations per tick. */
+static long long
+loops_per_tick (void) 
+{
+  long long loops = 0;
+  int64_t start, end;
+
+  /* Start at a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+
+  end = start + 1 + MEASURE_TICKS;
+  while (timer_ticks () < end)
+    loops++;
+  return loops / MEASURE_TICKS;
+}
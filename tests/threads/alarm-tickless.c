@@ -0,0 +1,66 @@
+/* Run with -tickless.  Creates a few threads that sleep
+   different durations several times each while the CPU is
+   otherwise idle, and checks that each one wakes up on exactly
+   the tick it asked for, so the ticks skipped while the timer
+   was stopped must have been caught up.  The .ck file also
+   checks that there were far fewer timer interrupts than ticks. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 5
+
+static struct semaphore done;
+static int64_t start;
+static int late_cnt;
+
+static thread_func sleeper;
+
+void
+test_alarm_tickless (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (timer_tickless);
+
+  sema_init (&done, 0);
+  late_cnt = 0;
+  start = timer_ticks () + 10;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, (void *) (long) ((i + 2) * 10));
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  if (late_cnt != 0)
+    fail ("%d wakeups were not on the requested tick", late_cnt);
+  msg ("All threads woke on time.");
+}
+
+/* Sleeps ITERATIONS times for the number of ticks in AUX each,
+   checking the tick it wakes up on. */
+static void
+sleeper (void *duration_) 
+{
+  int duration = (long) duration_;
+  int i;
+
+  for (i = 1; i <= ITERATIONS; i++) 
+    {
+      int64_t wakeup = start + i * duration;
+      timer_sleep (wakeup - timer_ticks ());
+      if (timer_ticks () != wakeup)
+        late_cnt++;
+    }
+  sema_up (&done);
+}
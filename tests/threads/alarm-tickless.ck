@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+# Mostly idle, so most ticks should have passed without an interrupt.
+my ($timer) = grep (/Timer: \d+ ticks, \d+ interrupts/, @output);
+fail "missing timer statistics\n" if !defined $timer;
+my ($ticks, $interrupts) = $timer =~ /(\d+) ticks, (\d+) interrupts/;
+fail "$interrupts timer interrupts in $ticks ticks\n"
+  if $interrupts * 2 > $ticks;
+
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) All threads woke on time.
+(alarm-tickless) end
+EOF
+pass;
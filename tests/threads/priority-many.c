@@ -0,0 +1,76 @@
+/* Creates a few hundred threads spread over every priority
+   below PRI_MAX, then lets them all run at once.  They must run
+   highest priority first, and in creation order among threads
+   of the same priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 300
+
+struct many_thread_data
+  {
+    int id;                     /* Thread ID. */
+    int priority;               /* Priority it was created with. */
+  };
+
+static struct many_thread_data data[THREAD_CNT];
+static int order[THREAD_CNT];   /* IDs in the order the threads ran. */
+static int order_cnt;
+
+static thread_func many_thread_func;
+
+void
+test_priority_many (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  thread_set_priority (PRI_MAX);
+  order_cnt = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      struct many_thread_data *d = data + i;
+      snprintf (name, sizeof name, "many %d", i);
+      d->id = i;
+      d->priority = PRI_MIN + 1 + (i * 7) % (PRI_MAX - PRI_MIN - 1);
+      thread_create (name, d->priority, many_thread_func, d);
+    }
+  msg ("%d threads created.", THREAD_CNT);
+
+  /* Every other thread now outranks us and runs to completion. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (order_cnt != THREAD_CNT)
+    fail ("only %d of %d threads ran", order_cnt, THREAD_CNT);
+  for (i = 1; i < THREAD_CNT; i++)
+    {
+      struct many_thread_data *a = data + order[i - 1];
+      struct many_thread_data *b = data + order[i];
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->id > b->id))
+        fail ("thread %d (priority %d) ran before thread %d (priority %d)",
+              a->id, a->priority, b->id, b->priority);
+    }
+  msg ("Threads ran in priority order.");
+}
+
+static void 
+many_thread_func (void *data_) 
+{
+  struct many_thread_data *data = data_;
+  enum intr_level old_level = intr_disable ();
+  order[order_cnt++] = data->id;
+  intr_set_level (old_level);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-many) begin
+(priority-many) 300 threads created.
+(priority-many) Threads ran in priority order.
+(priority-many) end
+EOF
+pass;
@@ -17,6 +17,8 @@ static const struct test tests[] =
         {"alarm-priority", test_alarm_priority},
         {"alarm-zero", test_alarm_zero},
         {"alarm-negative", test_alarm_negative},
+        {"alarm-bench", test_alarm_bench},
+        {"alarm-tickless", test_alarm_tickless},
         {"priority-change", test_priority_change},
         {"priority-donate-one", test_priority_donate_one},
         {"priority-donate-multiple", test_priority_donate_multiple},
@@ -26,6 +28,7 @@ static const struct test tests[] =
         {"priority-donate-lower", test_priority_donate_lower},
         {"priority-donate-chain", test_priority_donate_chain},
         {"priority-fifo", test_priority_fifo},
+        {"priority-many", test_priority_many},
         {"priority-preempt", test_priority_preempt},
         {"priority-sema", test_priority_sema},
         {"priority-condvar", test_priority_condvar},
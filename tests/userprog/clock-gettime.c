@@ -0,0 +1,51 @@
+/* Reads CLOCK_MONOTONIC many times in a row.  The readings must
+   never go backward, must be well formed, and must resolve
+   intervals shorter than a 10 ms timer tick.  An unknown clock
+   must be rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define READ_CNT 1000
+#define TICK_NS 10000000
+
+static int64_t
+to_ns (const struct timespec *ts) 
+{
+  return ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void
+test_main (void) 
+{
+  struct timespec ts;
+  int64_t prev, now, finest;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC + 100, &ts) == -1,
+         "clock_gettime with an unknown clock");
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &ts) == 0,
+         "clock_gettime (CLOCK_MONOTONIC)");
+  prev = to_ns (&ts);
+  finest = INT64_MAX;
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0)
+        fail ("clock_gettime failed on reading %d", i);
+      if (ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000)
+        fail ("tv_nsec out of range: %ld", ts.tv_nsec);
+      now = to_ns (&ts);
+      if (now < prev)
+        fail ("clock went backward by %lld ns", (long long) (prev - now));
+      if (now > prev && now - prev < finest)
+        finest = now - prev;
+      prev = now;
+    }
+
+  if (finest >= TICK_NS)
+    fail ("smallest step between readings was %lld ns",
+          (long long) finest);
+  msg ("clock resolves less than a tick");
+}
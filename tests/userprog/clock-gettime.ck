@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) clock_gettime with an unknown clock
+(clock-gettime) clock_gettime (CLOCK_MONOTONIC)
+(clock-gettime) clock resolves less than a tick
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
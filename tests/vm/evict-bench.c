@@ -0,0 +1,76 @@
+/* Page replacement benchmark.  Runs the access patterns of
+   page-linear, page-shuffle and swap-fork/child-swap over more
+   memory than the machine has, so the policy chosen with -evict
+   decides how many pages fault and go through swap:
+
+   - linear: sweeps a buffer larger than memory front to back,
+     where recency does not predict reuse.
+   - hot/cold: reads a small hot set at random between strides
+     of a large cold buffer, where it does.
+   - fork: children exec child-swap and touch their own stacks
+     while the parent's pages are still resident.
+
+   Checks the data; the kernel prints the page fault and swap
+   counts at power off (see "make evict-bench"). */
+
+#include <string.h>
+#include <syscall.h>
+#include <random.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define COLD_SIZE (6 * 1024 * 1024)
+#define HOT_SIZE (256 * 1024)
+#define SWEEPS 3
+#define HOT_ROUNDS 64
+#define CHILD_CNT 4
+
+static char cold[COLD_SIZE];
+static char hot[HOT_SIZE];
+
+void
+test_main (void)
+{
+  pid_t child[CHILD_CNT];
+  size_t i, j, round;
+
+  /* Linear sweeps. */
+  for (i = 0; i < COLD_SIZE; i += PAGE_SIZE)
+    cold[i] = i / PAGE_SIZE;
+  for (round = 0; round < SWEEPS; round++)
+    for (i = 0; i < COLD_SIZE; i += PAGE_SIZE)
+      if (cold[i] != (char) (i / PAGE_SIZE))
+        fail ("cold page %zu is corrupted", i / PAGE_SIZE);
+  msg ("linear");
+
+  /* Hot set read at random, cold buffer walked in strides. */
+  for (i = 0; i < HOT_SIZE; i += PAGE_SIZE)
+    hot[i] = i / PAGE_SIZE;
+  for (round = 0; round < HOT_ROUNDS; round++)
+    {
+      for (j = 0; j < HOT_SIZE / PAGE_SIZE; j++)
+        {
+          size_t page = random_ulong () % (HOT_SIZE / PAGE_SIZE);
+          if (hot[page * PAGE_SIZE] != (char) page)
+            fail ("hot page %zu is corrupted", page);
+        }
+      for (i = round * PAGE_SIZE * 16 % COLD_SIZE; i < COLD_SIZE;
+           i += PAGE_SIZE * HOT_ROUNDS)
+        if (cold[i] != (char) (i / PAGE_SIZE))
+          fail ("cold page %zu is corrupted", i / PAGE_SIZE);
+    }
+  msg ("hot/cold");
+
+  /* Children compete with the parent's resident pages. */
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      child[i] = fork ("child-swap");
+      if (child[i] == 0 && exec ("child-swap") == -1)
+        fail ("exec \"child-swap\"");
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (child[i]) != 0)
+      fail ("child %zu failed", i);
+  msg ("fork");
+}
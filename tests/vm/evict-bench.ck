@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(evict-bench) begin
+(evict-bench) linear
+(evict-bench) hot/cold
+(evict-bench) fork
+(evict-bench) end
+EOF
+pass;
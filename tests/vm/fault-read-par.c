@@ -0,0 +1,85 @@
+/* Forks a child that reads a file over and over while the
+   parent sweeps an anonymous buffer larger than memory, so
+   that the parent's faults, stack growth and swap-ins run
+   while the child is inside read().  Both sides check what
+   they got. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024)
+#define READ_CNT 32
+#define BUF_SIZE (6 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char file_buf[FILE_SIZE];
+static char buf[BUF_SIZE];
+
+static void
+read_file (void)
+{
+  static char chunk[PAGE_SIZE];
+  int fd, i;
+  size_t ofs, j;
+
+  /* No messages here: they would race with the parent's. */
+  fd = open ("data");
+  if (fd < 2)
+    fail ("child could not open \"data\"");
+  for (i = 0; i < READ_CNT; i++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += PAGE_SIZE)
+        {
+          if (read (fd, chunk, PAGE_SIZE) != PAGE_SIZE)
+            fail ("short read at %zu", ofs);
+          for (j = 0; j < PAGE_SIZE; j++)
+            if (chunk[j] != (char) ((ofs + j) % 251))
+              fail ("byte %zu of \"data\" is wrong", ofs + j);
+        }
+    }
+  close (fd);
+}
+
+/* Touches a new stack page in each call. */
+static int
+grow_stack (int depth)
+{
+  volatile char frame[PAGE_SIZE];
+  frame[0] = depth;
+  return depth == 0 ? frame[0] : grow_stack (depth - 1) + frame[0];
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int fd;
+  pid_t child;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    file_buf[i] = i % 251;
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, file_buf, FILE_SIZE) == FILE_SIZE, "write \"data\"");
+  close (fd);
+
+  child = fork ("reader");
+  if (child == 0)
+    {
+      read_file ();
+      exit (81);
+    }
+
+  for (i = 0; i < BUF_SIZE; i += PAGE_SIZE)
+    buf[i] = i / PAGE_SIZE;
+  grow_stack (32);
+  for (i = 0; i < BUF_SIZE; i += PAGE_SIZE)
+    if (buf[i] != (char) (i / PAGE_SIZE))
+      fail ("page %zu of buf is wrong", i / PAGE_SIZE);
+  msg ("anonymous pages intact");
+
+  CHECK (wait (child) == 81, "wait for child");
+}
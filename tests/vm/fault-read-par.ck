@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-read-par) begin
+(fault-read-par) create "data"
+(fault-read-par) open "data"
+(fault-read-par) write "data"
+(fault-read-par) anonymous pages intact
+(fault-read-par) wait for child
+(fault-read-par) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Reads one byte of every page of a 4 MB buffer, many times over,
+   so that the run time is dominated by TLB misses.  Run it with
+   and without the kernel's -no-huge option and compare the timer
+   ticks printed at shutdown to see what 2 MB pages save. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define ROUNDS 256
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  volatile char *p = buf;
+  unsigned sum = 0, expected = 0;
+  size_t i, round;
+
+  /* Dirty every page so that the whole buffer is resident. */
+  msg ("initialize");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    p[i] = i / PAGE_SIZE;
+
+  msg ("strided passes");
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < SIZE; i += PAGE_SIZE)
+      sum += p[i];
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    expected += (char) (i / PAGE_SIZE);
+  expected *= ROUNDS;
+  if (sum != expected)
+    fail ("sum %u != %u", sum, expected);
+  msg ("verified");
+}
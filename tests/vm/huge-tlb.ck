@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-tlb) begin
+(huge-tlb) initialize
+(huge-tlb) strided passes
+(huge-tlb) verified
+(huge-tlb) end
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Fills many pages with a few repeating patterns so that the
+   samepage merging thread (-ksm) can back them with shared
+   frames, sleeps long enough for it to scan every frame twice,
+   then writes to some of the pages from user code and through
+   read() and checks that no write leaks into a page with the
+   same contents.  The .ck file checks that pages were merged. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+#define PAGE_SIZE 4096
+#define PATTERN_CNT 4
+
+/* Run with -ul=512: ksmd looks at 64 frames every 10 ticks, so
+   two passes over 512 frames take 160 ticks. */
+#define IDLE_SEC 3
+
+static char pages[PAGE_CNT][PAGE_SIZE];
+
+static char
+expected (size_t page, size_t ofs)
+{
+  if (page % PATTERN_CNT == 0)
+    return 0;
+  return 'a' + page % PATTERN_CNT + (ofs % 64 == 0);
+}
+
+void
+test_main (void)
+{
+  struct timespec idle = {IDLE_SEC, 0};
+  size_t i, j;
+  int fd;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      pages[i][j] = expected (i, j);
+  msg ("filled");
+
+  /* The scanner runs when every user thread is blocked. */
+  CHECK (clock_nanosleep (CLOCK_MONOTONIC, &idle) == 0, "idle");
+
+  for (i = 1; i < PAGE_CNT; i += 2)
+    pages[i][100] = 'z';
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (fd, pages[2], 64) == 64, "read \"sample.txt\"");
+  close (fd);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      {
+        char c = expected (i, j);
+        if (i % 2 == 1 && j == 100)
+          c = 'z';
+        if (i == 2 && j < 64)
+          c = pages[i][j];
+        if (pages[i][j] != c)
+          fail ("byte %zu of page %zu is %d, expected %d",
+                j, i, pages[i][j], c);
+      }
+  if (memcmp (pages[2], "===  ALL USERS PLEASE NOTE", 26))
+    fail ("read() data missing from page 2");
+  msg ("pages intact");
+}
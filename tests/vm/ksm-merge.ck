@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+# ksmd had two full passes over the frames while the test slept.
+my ($ksm) = grep (/KSM: \d+ pages scanned, \d+ merged/, @output);
+fail "missing KSM statistics\n" if !defined $ksm;
+my ($merged) = $ksm =~ /(\d+) merged/;
+fail "ksmd merged no pages\n" if $merged == 0;
+
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) filled
+(ksm-merge) idle
+(ksm-merge) open "sample.txt"
+(ksm-merge) read "sample.txt"
+(ksm-merge) pages intact
+(ksm-merge) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Maps anonymous memory at an address chosen by the kernel and
+   uses it as a heap larger than the stack limit.  Then checks
+   that a forked child gets its own copy of it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  char *heap;
+  size_t i;
+  pid_t pid;
+
+  CHECK ((heap = mmap (NULL, SIZE, MAP_WRITE | MAP_ANONYMOUS, -1, 0))
+         != MAP_FAILED, "mmap anonymous");
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    {
+      if (heap[i] != 0)
+        fail ("byte %zu is not zero", i);
+      heap[i] = i / PAGE_SIZE;
+    }
+  msg ("filled");
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      for (i = 0; i < SIZE; i += PAGE_SIZE)
+        {
+          if (heap[i] != (char) (i / PAGE_SIZE))
+            fail ("child sees wrong byte at %zu", i);
+          heap[i] = 'c';
+        }
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (heap[i] != (char) (i / PAGE_SIZE))
+      fail ("child's write leaked into parent at %zu", i);
+  msg ("parent's copy is intact");
+
+  munmap (heap);
+  msg ("unmapped");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous
+(mmap-anon) filled
+(mmap-anon) wait for child
+(mmap-anon) parent's copy is intact
+(mmap-anon) unmapped
+(mmap-anon) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Maps shared anonymous memory, forks, and checks that the
+   parent sees what the child wrote, including to pages that
+   neither had touched before the fork. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 4
+#define PAGE_INTS (4096 / sizeof (int))
+
+void
+test_main (void)
+{
+  int *shared;
+  pid_t pid;
+  size_t i;
+
+  CHECK ((shared = mmap (NULL, PAGE_CNT * 4096,
+                         MAP_WRITE | MAP_ANONYMOUS | MAP_SHARED, -1, 0))
+         != MAP_FAILED, "mmap shared anonymous");
+  shared[0] = 1;
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      if (shared[0] != 1)
+        fail ("child sees %d instead of 1", shared[0]);
+      for (i = 0; i < PAGE_CNT; i++)
+        shared[i * PAGE_INTS] = 100 + i;
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (shared[i * PAGE_INTS] != (int) (100 + i))
+      fail ("page %zu holds %d, not %d", i, shared[i * PAGE_INTS], (int) (100 + i));
+  msg ("parent sees child's writes");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-shared) begin
+(mmap-shared) mmap shared anonymous
+(mmap-shared) wait for child
+(mmap-shared) parent sees child's writes
+(mmap-shared) end
+EOF
+pass;
@@ -0,0 +1,79 @@
+/* Forks children that together touch more memory than RAM and
+   swap can hold.  The kernel must not panic: it should kill the
+   biggest processes, which then exit with -1, and give their
+   memory back so that a small process still runs afterward.
+   The whole thing is repeated to catch leaks. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HOG_CNT 4
+#define HOG_SIZE (8 * 1024 * 1024)
+#define SMALL_SIZE (256 * 1024)
+#define ROUNDS 3
+#define PAGE_SIZE 4096
+
+static unsigned buf[HOG_SIZE / sizeof (unsigned)];
+
+/* Fills the first SIZE bytes of BUF with a sequence that does
+   not compress, reads it back, and exits with 0. */
+static void
+touch (size_t size, unsigned seed)
+{
+  size_t cnt = size / sizeof *buf;
+  unsigned x = seed;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    buf[i] = x = x * 1103515245 + 12345;
+
+  x = seed;
+  for (i = 0; i < cnt; i++)
+    {
+      x = x * 1103515245 + 12345;
+      if (buf[i] != x)
+        fail ("word %zu of %zu is corrupted", i, cnt);
+    }
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  pid_t child[HOG_CNT];
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      int killed = 0;
+      pid_t pid;
+
+      for (i = 0; i < HOG_CNT; i++)
+        {
+          child[i] = fork ("hog");
+          if (child[i] == 0)
+            touch (HOG_SIZE, round * HOG_CNT + i + 1);
+          if (child[i] < 0)
+            fail ("fork hog %d", i);
+        }
+      for (i = 0; i < HOG_CNT; i++)
+        {
+          int status = wait (child[i]);
+          if (status == -1)
+            killed++;
+          else if (status != 0)
+            fail ("hog %d exited with %d", i, status);
+        }
+      if (killed == 0)
+        fail ("round %d: no hog was killed", round);
+
+      /* The killed hogs' memory must be back. */
+      pid = fork ("small");
+      if (pid == 0)
+        touch (SMALL_SIZE, round);
+      if (wait (pid) != 0)
+        fail ("round %d: small child did not finish", round);
+      msg ("round %d done", round);
+    }
+}
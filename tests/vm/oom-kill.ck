@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(oom-kill) begin
+(oom-kill) round 0 done
+(oom-kill) round 1 done
+(oom-kill) round 2 done
+(oom-kill) end
+EOF
+pass;
@@ -19,6 +19,7 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -84,6 +85,7 @@ int main(void)
 	/* Initialize memory system. */
 	mem_end = palloc_init();
 	malloc_init();
+	slab_init();
 	paging_init(mem_end);
 
 #ifdef USERPROG
@@ -227,11 +229,32 @@ parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-tickless"))
+			timer_tickless = true;
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
 		else if (!strcmp(name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp(name, "-kswapd-low"))
+			kswapd_low_wmark = atoi(value);
+		else if (!strcmp(name, "-kswapd-high"))
+			kswapd_high_wmark = atoi(value);
+		else if (!strcmp(name, "-fault-around"))
+			fault_around_max = atoi(value);
+		else if (!strcmp(name, "-no-huge"))
+			vm_huge_pages = false;
+		else if (!strcmp(name, "-zswap"))
+			zswap_max_pages = atoi(value);
+		else if (!strcmp(name, "-ksm"))
+			vm_ksm = true;
+		else if (!strcmp(name, "-evict"))
+		{
+			if (!evict_policy_select(value))
+				PANIC("unknown replacement policy `%s' (use clock, lru or car)", value);
+		}
 #endif
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
@@ -339,8 +362,18 @@ usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -tickless          Stop the timer tick while the CPU is idle.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+		   "  -kswapd-low=COUNT  Wake kswapd below COUNT free user pages.\n"
+		   "  -kswapd-high=COUNT Let kswapd reclaim up to COUNT free user pages.\n"
+		   "  -fault-around=COUNT Map up to COUNT file pages per fault (0 disables).\n"
+		   "  -no-huge           Do not map anonymous memory with 2 MB pages.\n"
+		   "  -zswap=COUNT       Keep up to COUNT pages of compressed swap in RAM.\n"
+		   "  -ksm               Merge identical anonymous pages in the background.\n"
+		   "  -evict=POLICY      Page replacement policy: clock (default), lru, car.\n"
 #endif
 	);
 	power_off();
@@ -372,8 +405,14 @@ print_stats(void)
 	disk_print_stats();
 #endif
 	console_print_stats();
+	slab_print_stats();
 	kbd_print_stats();
 #ifdef USERPROG
 	exception_print_stats();
 #endif
+#ifdef VM
+	vm_print_stats();
+	if (vm_ksm)
+		ksm_print_stats();
+#endif
 }
@@ -8,6 +8,41 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Replaces the 2 MB mapping in page directory entry PDE by a page
+ * table of 4 KB entries for the same frames with the same flags.
+ * Returns false if no page is available for the table. */
+static bool
+pde_split(uint64_t *pde)
+{
+	uint64_t *pt = palloc_get_page(0);
+	if (pt == NULL)
+		return false;
+
+	uint64_t pa = PTE_ADDR(*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+	for (unsigned i = 0; i < HUGE_PGCNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop(pt) | PTE_U | PTE_W | PTE_P;
+
+	/* The TLB may hold the 2 MB translation of whichever pml4 is active. */
+	lcr3(rcr3());
+	return true;
+}
+
+/* Returns the page directory entry for VA in PML4, or a null pointer
+ * if the page directory does not exist. */
+static uint64_t *
+pde_lookup(uint64_t *pml4, const uint64_t va)
+{
+	if (!(pml4[PML4(va)] & PTE_P))
+		return NULL;
+	uint64_t *pdp = ptov(PTE_ADDR(pml4[PML4(va)]));
+	if (!(pdp[PDPE(va)] & PTE_P))
+		return NULL;
+	uint64_t *pd = ptov(PTE_ADDR(pdp[PDPE(va)]));
+	return &pd[PDX(va)];
+}
+
 static uint64_t *
 pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 {
@@ -15,6 +50,17 @@ pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 	if (pdp)
 	{
 		uint64_t *pte = (uint64_t *)pdp[idx];
+		/* A 2 MB page has no page table.  Lookups get the page
+		 * directory entry itself, whose A/D/W bits apply to the whole
+		 * huge page; callers that change one 4 KB page (CREATE) split
+		 * it first. */
+		if (((uint64_t)pte & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+		{
+			if (!create)
+				return &pdp[idx];
+			if (!pde_split(&pdp[idx]))
+				return NULL;
+		}
 		if (!((uint64_t)pte & PTE_P))
 		{
 			if (create)
@@ -149,7 +195,16 @@ pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux,
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		if ((pdp[i] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+		{
+			/* A 2 MB page is passed as its page directory entry. */
+			void *va = (void *)(((uint64_t)pml4_index << PML4SHIFT) |
+								((uint64_t)pdp_index << PDPESHIFT) |
+								((uint64_t)i << PDXSHIFT));
+			if (!func(&pdp[i], va, aux))
+				return false;
+		}
+		else if (((uint64_t)pte) & PTE_P)
 			if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
 							 pml4_index, pdp_index, i))
 				return false;
@@ -203,6 +258,10 @@ pgdir_destroy(uint64_t *pdp)
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
+		/* The frames behind a 2 MB page belong to the frame table.
+		 * Tearing down the supplemental page table splits and clears
+		 * every huge mapping before the page table goes away. */
+		ASSERT((pdp[i] & (PTE_P | PTE_PS)) != (PTE_P | PTE_PS));
 		if (((uint64_t)pte) & PTE_P)
 			pt_destroy(PTE_ADDR(pte));
 	}
@@ -254,7 +313,11 @@ pml4_get_page(uint64_t *pml4, const void *uaddr)
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
+	{
+		if (*pte & PTE_PS)
+			return ptov(PTE_ADDR(*pte)) + ((uint64_t)uaddr & (HUGE_PGSIZE - 1));
 		return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
+	}
 	return NULL;
 }
 
@@ -291,6 +354,13 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 	ASSERT(is_user_vaddr(upage));
 
 	pte = pml4e_walk(pml4, (uint64_t)upage, false);
+	/* Only this 4 KB page goes away, so split a 2 MB page first. */
+	if (pte != NULL && (*pte & PTE_PS) != 0)
+	{
+		pte = pml4e_walk(pml4, (uint64_t)upage, true);
+		if (pte == NULL)
+			PANIC("pml4_clear_page: cannot split 2 MB page");
+	}
 
 	if (pte != NULL && (*pte & PTE_P) != 0)
 	{
@@ -320,7 +390,7 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t)PTE_D;
+			*pte &= ~(uint64_t)PTE_D;
 
 		if (rcr3() == vtop(pml4))
 			invlpg((uint64_t)vpage);
@@ -347,9 +417,40 @@ void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t)PTE_A;
+			*pte &= ~(uint64_t)PTE_A;
 
 		if (rcr3() == vtop(pml4))
 			invlpg((uint64_t)vpage);
 	}
 }
+
+/* Maps the 2 MB user region starting at UPAGE to the physically
+ * contiguous frames starting at KPAGE with a single page directory
+ * entry.  Both must be 2 MB aligned.  The region must currently be
+ * mapped with 4 KB pages; their page table is freed, the frames are
+ * not.  Returns false if the region has no page table. */
+bool pml4_set_huge_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
+{
+	ASSERT(((uint64_t)upage & (HUGE_PGSIZE - 1)) == 0);
+	ASSERT((vtop(kpage) & (HUGE_PGSIZE - 1)) == 0);
+	ASSERT(is_user_vaddr(upage));
+	ASSERT(pml4 != base_pml4);
+
+	uint64_t *pde = pde_lookup(pml4, (uint64_t)upage);
+	if (pde == NULL || (*pde & (PTE_P | PTE_PS)) != PTE_P)
+		return false;
+
+	uint64_t *pt = ptov(PTE_ADDR(*pde));
+	*pde = vtop(kpage) | PTE_P | PTE_PS | PTE_A | (rw ? PTE_W : 0) | PTE_U;
+	if (rcr3() == vtop(pml4))
+		lcr3(rcr3());
+	palloc_free_page(pt);
+	return true;
+}
+
+/* Returns true if UPAGE in PML4 is part of a 2 MB page. */
+bool pml4_is_huge(uint64_t *pml4, const void *upage)
+{
+	uint64_t *pde = pde_lookup(pml4, (uint64_t)upage);
+	return pde != NULL && (*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
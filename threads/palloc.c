@@ -284,6 +284,42 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Like palloc_get_multiple(), but the returned block is also
+   aligned to PAGE_CNT pages, which must be a power of two.  Used
+   for 2 MB (huge) page frames. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_cnt = bitmap_size (pool->used_map);
+	size_t align = page_cnt * PGSIZE;
+	size_t page_idx;
+	void *pages = NULL;
+
+	ASSERT ((page_cnt & (page_cnt - 1)) == 0);
+
+	/* First index whose address is aligned. */
+	page_idx = (ROUND_UP ((uint64_t) pool->base, align)
+			- (uint64_t) pool->base) / PGSIZE;
+
+	lock_acquire (&pool->lock);
+	for (; page_idx + page_cnt <= pool_cnt; page_idx += page_cnt)
+		if (bitmap_none (pool->used_map, page_idx, page_cnt)) {
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, PGSIZE * page_cnt);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of pages");
+	}
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -328,6 +364,40 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages managed by the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_cnt (void) {
+	size_t cnt;
+
+	lock_acquire (&user_pool.lock);
+	cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
+	lock_release (&user_pool.lock);
+	return cnt;
+}
+
+/* Returns the index of user pool page PAGE, counted from the
+   base of the pool.  PAGE must belong to the user pool. */
+size_t
+palloc_user_page_idx (void *page) {
+	ASSERT (page_from_pool (&user_pool, page));
+	return pg_no (page) - pg_no (user_pool.base);
+}
+
+/* Returns the kernel virtual address of the IDX'th page of the
+   user pool. */
+void *
+palloc_user_page (size_t idx) {
+	ASSERT (idx < bitmap_size (user_pool.used_map));
+	return user_pool.base + PGSIZE * idx;
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
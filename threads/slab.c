@@ -0,0 +1,202 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator in the style of Bonwick's object caches.
+
+   Each cache hands out objects of one type.  Memory comes from
+   the kernel pool one page at a time; each page (a "slab")
+   starts with a header, then an array of free-list links, then
+   the objects themselves.  Keeping the links outside the
+   objects means a freed object is never written to, so the
+   constructor runs only once per object, when its slab is
+   created, and callers must give objects back in their
+   constructed state.
+
+   A cache keeps the slabs that still have free objects on its
+   PARTIAL list.  Allocation takes an object from the first
+   partial slab; only when there is none does it go to the page
+   allocator.  A slab whose objects are all free goes back to the
+   page allocator, unless it is the cache's last one with room. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* End of a slab's free list. */
+#define SLAB_NONE UINT16_MAX
+
+/* Slab header, at the start of each slab page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in CACHE's partial list. */
+	size_t in_use;              /* Objects handed out. */
+	uint16_t free;              /* Index of first free object. */
+	uint8_t *objs;              /* First object. */
+	uint16_t next[];            /* Free list links, one per object. */
+};
+
+/* All caches, for statistics. */
+static struct list caches;
+
+static struct slab *slab_create (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *);
+
+/* Initializes the slab allocator. */
+void
+slab_init (void) {
+	list_init (&caches);
+}
+
+/* Initializes cache C for objects of SIZE bytes.  CTOR, if
+   nonnull, is called once on each object when its slab is
+   created. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t size,
+		void (*ctor) (void *)) {
+	size_t n;
+
+	ASSERT (size > 0);
+
+	c->name = name;
+	c->obj_size = ROUND_UP (size, sizeof (void *));
+	c->ctor = ctor;
+	list_init (&c->partial);
+	lock_init (&c->lock);
+
+	/* Fit as many objects as possible after the header and links. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				sizeof (void *)) + n * c->obj_size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < SLAB_NONE);
+	c->objs_per_slab = n;
+
+	c->alloc_cnt = c->free_cnt = c->grow_cnt = 0;
+	c->in_use = c->peak = c->slab_cnt = 0;
+	list_push_back (&caches, &c->elem);
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (list_empty (&c->partial)) {
+		s = slab_create (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+		c->grow_cnt++;
+	} else
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+
+	/* Take the first free object; a full slab leaves the list. */
+	obj = s->objs + s->free * c->obj_size;
+	s->free = s->next[s->free];
+	if (++s->in_use == c->objs_per_slab)
+		list_remove (&s->elem);
+
+	c->alloc_cnt++;
+	if (++c->in_use > c->peak)
+		c->peak = c->in_use;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* Returns OBJ, which must have come from slab_alloc(C), to C.
+   OBJ must be in the state its constructor left it in. */
+void
+slab_free (struct slab_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+	idx = ((uint8_t *) obj - s->objs) / c->obj_size;
+
+	lock_acquire (&c->lock);
+	if (s->in_use-- == c->objs_per_slab)
+		list_push_front (&c->partial, &s->elem);
+	s->next[idx] = s->free;
+	s->free = idx;
+	c->free_cnt++;
+	c->in_use--;
+
+	/* Give an entirely free slab back, unless it is the only one
+	   with room, so that one object going back and forth does not
+	   allocate and free a page each time. */
+	if (s->in_use == 0 && list_front (&c->partial) != list_back (&c->partial)) {
+		list_remove (&s->elem);
+		s->magic = 0;
+		palloc_free_page (s);
+		c->slab_cnt--;
+	}
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache. */
+void
+slab_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+		printf ("Slab %s: %zu in use (peak %zu), %zu pages, "
+				"%llu allocs (%llu new slab), %llu frees\n",
+				c->name, c->in_use, c->peak, c->slab_cnt,
+				(unsigned long long) c->alloc_cnt,
+				(unsigned long long) c->grow_cnt,
+				(unsigned long long) c->free_cnt);
+	}
+}
+
+/* Allocates a new slab for C and constructs its objects.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct slab_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->free = 0;
+	s->objs = (uint8_t *) s + ROUND_UP (sizeof *s
+			+ c->objs_per_slab * sizeof (uint16_t), sizeof (void *));
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : SLAB_NONE;
+		if (c->ctor != NULL)
+			c->ctor (s->objs + i * c->obj_size);
+	}
+	c->slab_cnt++;
+	return s;
+}
+
+/* Returns the slab that OBJ is inside. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid and OBJ is one of its objects. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((uint8_t *) obj >= s->objs
+			&& ((uint8_t *) obj - s->objs) % c->obj_size == 0);
+
+	return s;
+}
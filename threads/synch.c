@@ -115,6 +115,13 @@ void sema_up(struct semaphore *sema)
 	// TODO: Sort the waiters list in order of priority
 	if (!list_empty(&sema->waiters))
 	{
+		// 4BSD: 잠든 동안 밀린 감쇠를 반영해야 우선순위를 비교할 수 있다.
+		if (thread_mlfqs)
+		{
+			struct list_elem *e;
+			for (e = list_begin(&sema->waiters); e != list_end(&sema->waiters); e = list_next(e))
+				mlfqs_catch_up(list_entry(e, struct thread, elem));
+		}
 		list_sort(&sema->waiters, compare_priority, NULL);
 		thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
 	}
@@ -343,6 +350,19 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
 	// TODO: Sort the waiters list in order of priority
 	if (!list_empty(&cond->waiters))
 	{
+		// 4BSD: 잠든 동안 밀린 감쇠를 반영해야 우선순위를 비교할 수 있다.
+		if (thread_mlfqs)
+		{
+			enum intr_level old_level = intr_disable();
+			struct list_elem *e;
+			for (e = list_begin(&cond->waiters); e != list_end(&cond->waiters); e = list_next(e))
+			{
+				struct semaphore *sema = &list_entry(e, struct semaphore_elem, elem)->semaphore;
+				if (!list_empty(&sema->waiters))
+					mlfqs_catch_up(list_entry(list_front(&sema->waiters), struct thread, elem));
+			}
+			intr_set_level(old_level);
+		}
 		list_sort(&cond->waiters, compare_sema_priority, NULL);
 		sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
 	}
@@ -29,12 +29,27 @@
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-// 스레드 sleep 상태를 보관하기 위한 list
-static struct list sleep_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO per
+   priority, and bit P of ready_bitmap is set exactly when
+   ready_queues[P] is not empty, so queueing a thread, requeueing
+   it after a priority change and finding the highest-priority
+   ready thread all take constant time. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt; /* Number of ready threads. */
+
+/* Sleeping threads, as a binary min-heap keyed by local_tick:
+   sleep_heap[1] wakes up first and the children of sleep_heap[I]
+   are sleep_heap[2 * I] and sleep_heap[2 * I + 1].  Peeking at
+   the next deadline is O(1), so a tick with nobody to wake costs
+   the same however many threads sleep; sleeping and waking are
+   O(log n).  The array lives in SLEEP_HEAP_PAGES pages from the
+   kernel pool and doubles when full. */
+static struct thread **sleep_heap;
+static size_t sleep_cnt;		/* Number of sleeping threads. */
+static size_t sleep_cap;		/* Highest usable index. */
+static size_t sleep_heap_pages; /* Pages in SLEEP_HEAP. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -65,6 +80,18 @@ bool thread_mlfqs;
 /* 4BSD */
 static int load_avg = LOAD_AVG_DEFAULT;
 
+/* 4BSD recent_cpu decay is applied eagerly only to the running
+   and ready threads.  A blocked thread remembers in mlfqs_epoch
+   how many decays it has seen and catches up when it wakes, from
+   the last MLFQS_HISTORY decay factors kept here. */
+#define MLFQS_HISTORY 1024
+static int64_t mlfqs_epoch;					/* Number of decays so far. */
+static int mlfqs_decay_hist[MLFQS_HISTORY]; /* Decay factor of epoch E at E % MLFQS_HISTORY. */
+
+/* Threads whose recent_cpu or nice changed since their priority
+   was last computed. */
+static struct list mlfqs_dirty;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -73,6 +100,13 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static void ready_push(struct thread *);
+static void ready_remove(struct thread *);
+static int ready_max_priority(void);
+static bool sleep_heap_grow(void);
+static void sleep_heap_push(struct thread *);
+static struct thread *sleep_heap_pop(void);
+static void mlfqs_mark_dirty(struct thread *);
 
 /* Returns true if T appears to point to a valid thread. */
 // T가 유효한 스레드를 가리키는 것으로 보이면 true를 반환한다.
@@ -151,9 +185,14 @@ void thread_init(void)
 	// 전역 스레드 컨텍스트를 초기화한다
 	lock_init(&tid_lock);
 	list_init(&all_list); // all_list 초기화 코드 추가
-	list_init(&ready_list);
-	list_init(&sleep_list); // sleep_list 초기화 코드 추가
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init(&ready_queues[pri]);
+	ready_bitmap = 0;
+	ready_cnt = 0;
+	sleep_heap = NULL;
+	sleep_cnt = sleep_cap = sleep_heap_pages = 0;
 	list_init(&destruction_req);
+	list_init(&mlfqs_dirty);
 
 	/* Set up a thread structure for the running thread. */
 	// 실행 중인 스레드를 위한 스레드 구조를 설정한다.
@@ -204,9 +243,11 @@ void thread_tick(void)
 	else
 		kernel_ticks++;
 
-	/* Enforce preemption. */
+	/* Enforce preemption.  The idle thread has nobody to give way
+	   to, and timer_idle_exit() runs its ticks outside interrupt
+	   context. */
 	// 선점을 강제한다.
-	if (++thread_ticks >= TIME_SLICE)
+	if (t != idle_thread && ++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
 }
 
@@ -217,6 +258,21 @@ void thread_print_stats(void)
 		   idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* Invokes function FUNC on all threads, passing along AUX.
+   This function must be called with interrupts off. */
+void thread_foreach(thread_action_func *func, void *aux)
+{
+	struct list_elem *e;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, all_elem);
+		func(t, aux);
+	}
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -343,9 +399,10 @@ void thread_unblock(struct thread *t)
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
+	if (thread_mlfqs)
+		mlfqs_catch_up(t);
 	/* project 1 priority */
-	// list_push_back(&ready_list, &t->elem);
-	list_insert_ordered(&ready_list, &t->elem, compare_priority, NULL);
+	ready_push(t);
 	t->status = THREAD_READY;
 	intr_set_level(old_level);
 }
@@ -419,6 +476,8 @@ void thread_exit(void)
 
 	intr_disable();
 	list_remove(&thread_current()->all_elem);
+	if (thread_current()->mlfqs_dirty)
+		list_remove(&thread_current()->mlfqs_elem);
 	// list_remove(&thread_current()->all_elem); // 여기가 아닌가보다 쓰레드가 완전하게 지워지는 곳은 do_schedule(X) 🚨잘못된 정보!!!
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
@@ -447,8 +506,7 @@ void thread_yield(void)
 	old_level = intr_disable();
 	if (curr != idle_thread)
 		/* project 1 priority */
-		// list_push_back(&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list, &curr->elem, compare_priority, NULL);
+		ready_push(curr);
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
 }
@@ -457,14 +515,14 @@ void thread_yield(void)
 // 스레드 재우는 함수
 void thread_sleep(int64_t wakeup_ticks)
 {
-	/* 여기에 스레드 block 처리해서 sleep_list에 넣는 작업 필요*/
+	/* 여기에 스레드 block 처리해서 sleep_heap에 넣는 작업 필요*/
 	/* if the current thread is not idle thread,
 	   change the state of the caller thread to BLOCKED,
 	   store the local tick to wake up,
 	   update the global tick if necessary,
 	   and call schedule()
 	   만약 idle 스레드가 아니라면, 스레드 상태를 blocked로 변경하고,
-	   로컬tick에 깨어날 시간을 저장해놔라 (변경하고 sleep_list에 삽입). 필요하다면
+	   로컬tick에 깨어날 시간을 저장해놔라 (변경하고 sleep_heap에 삽입). 필요하다면
 	   글로벌 tick을 업데이트하고,
 	   스케줄함수를 호출해라 (컨텍스트 스위칭)*/
 	/* When you manipulate thread list, disable interrupt!
@@ -475,39 +533,126 @@ void thread_sleep(int64_t wakeup_ticks)
 
 	ASSERT(!intr_context());
 
-	old_level = intr_disable(); // 인터럽트 비활성화
+	// 힙이 가득 찼으면 인터럽트를 켠 채로 늘린다. (palloc은 락을 잡는다)
+	// 늘리지 못하면 예전처럼 양보하면서 기다린다.
+	for (;;)
+	{
+		old_level = intr_disable(); // 인터럽트 비활성화
+		if (curr == idle_thread || sleep_cnt < sleep_cap)
+			break;
+		intr_set_level(old_level);
+		if (!sleep_heap_grow())
+		{
+			while (timer_ticks() < wakeup_ticks)
+				thread_yield();
+			return;
+		}
+	}
 
-	// 현재 스레드가 idle 스레드가 아니면 준비리스트-> 수면리스트로 삽입
+	// 현재 스레드가 idle 스레드가 아니면 준비리스트-> 수면 힙으로 삽입
 	if (curr != idle_thread)
 	{
-		curr->local_tick = wakeup_ticks;									// local tick에 깨어날 시간 저장해주기
-		list_insert_ordered(&sleep_list, &curr->elem, compare_ticks, NULL); // 수면큐에 삽입
-		thread_block();														// 현재 스레드 blocked 상태로 변경
+		curr->local_tick = wakeup_ticks; // local tick에 깨어날 시간 저장해주기
+		sleep_heap_push(curr);			 // 수면 힙에 삽입
+		thread_block();					 // 현재 스레드 blocked 상태로 변경
 	}
 	intr_set_level(old_level); // 인터럽트 활성화
 }
 
 // 잠자는 스레드 깨우는 함수
+// 타이머 인터럽트에서 불리므로 인터럽트는 꺼져 있다.
 void thread_wakeup(int64_t wakeup_ticks)
 {
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	// 가장 먼저 깨어날 스레드만 보면 되므로, 깨울 스레드가 없는 tick은 O(1)이다.
+	while (thread_next_wakeup() <= wakeup_ticks)
+		thread_unblock(sleep_heap_pop()); // 수면 힙에서 꺼내 차단 해제
+}
+
+/* Returns the tick at which the next sleeping thread wakes up,
+   or INT64_MAX if no thread is sleeping. */
+int64_t
+thread_next_wakeup(void)
+{
+	return sleep_cnt > 0 ? sleep_heap[1]->local_tick : INT64_MAX;
+}
+
+/* Doubles the capacity of the sleep heap.  Must be called with
+   interrupts on, because the page allocator takes a lock.
+   Returns false if memory is not available. */
+static bool
+sleep_heap_grow(void)
+{
+	size_t pages = sleep_heap_pages != 0 ? sleep_heap_pages * 2 : 1;
+	struct thread **heap = palloc_get_multiple(0, pages);
+	enum intr_level old_level;
 
-	while (true)
+	ASSERT(intr_get_level() == INTR_ON);
+	if (heap == NULL)
+		return false;
+
+	/* Another thread may have grown the heap meanwhile. */
+	old_level = intr_disable();
+	if (pages > sleep_heap_pages)
 	{
-		// local_tick이 최소값을 가지는 스레드 반환
-		struct list_elem *curr = list_min(&sleep_list, compare_ticks, NULL);
-		struct thread *thread = list_entry(curr, struct thread, elem);
+		struct thread **old = sleep_heap;
+		size_t old_pages = sleep_heap_pages;
+
+		if (sleep_cnt > 0)
+			memcpy(heap + 1, sleep_heap + 1, sleep_cnt * sizeof *heap);
+		sleep_heap = heap;
+		sleep_heap_pages = pages;
+		sleep_cap = pages * PGSIZE / sizeof *heap - 1;
+		heap = old;
+		pages = old_pages;
+	}
+	intr_set_level(old_level);
 
-		if (thread->local_tick <= wakeup_ticks)
-		{
-			enum intr_level old_level;
-			old_level = intr_disable(); // 인터럽트 비활성화
-			list_remove(curr);			// 수면큐에서 깨울 스레드 지우기
-			thread_unblock(thread);		// 스레드 차단 해제
-		}
-		// 깨어날 스레드가 없으면 return
-		else
-			return;
+	if (heap != NULL)
+		palloc_free_multiple(heap, pages);
+	return true;
+}
+
+/* Adds T to the sleep heap, which must have room for it. */
+static void
+sleep_heap_push(struct thread *t)
+{
+	size_t i;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(sleep_cnt < sleep_cap);
+
+	/* Sift up from the new last slot. */
+	for (i = ++sleep_cnt; i > 1 && sleep_heap[i / 2]->local_tick > t->local_tick; i /= 2)
+		sleep_heap[i] = sleep_heap[i / 2];
+	sleep_heap[i] = t;
+}
+
+/* Removes and returns the thread that wakes up first. */
+static struct thread *
+sleep_heap_pop(void)
+{
+	struct thread *first, *last;
+	size_t i, child;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(sleep_cnt > 0);
+
+	first = sleep_heap[1];
+	last = sleep_heap[sleep_cnt--];
+
+	/* Sift the last thread down from the root. */
+	for (i = 1; (child = i * 2) <= sleep_cnt; i = child)
+	{
+		if (child < sleep_cnt && sleep_heap[child + 1]->local_tick < sleep_heap[child]->local_tick)
+			child++;
+		if (last->local_tick <= sleep_heap[child]->local_tick)
+			break;
+		sleep_heap[i] = sleep_heap[child];
 	}
+	sleep_heap[i] = last;
+	return first;
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -548,9 +693,8 @@ void thread_set_nice(int new_nice UNUSED)
 
 	enum intr_level old_level = intr_disable();
 	thread_current()->nice = new_nice;
-	// mlfqs_calculate_recent_cpu(thread_current()); // 빼야함
-	mlfqs_calculate_priority(thread_current()); // 변경된 nice 값으로 우선순위 재계산
-	// list_sort(&ready_list, compare_priority, NULL);
+	mlfqs_mark_dirty(thread_current()); // nice가 바뀌었으니 다음 재계산 대상에 넣는다.
+	mlfqs_calculate_priority(thread_current()); // 양보 여부를 정하기 위해 지금 바로 재계산
 	preemption_priority(); // 변경된 우선순위로 스케쥴링
 	intr_set_level(old_level);
 }
@@ -627,6 +771,10 @@ idle(void *idle_started_ UNUSED)
 		intr_disable();
 		thread_block();
 
+		/* Nothing to run: with -tickless, let the timer sleep
+		   until the next thread wakes up. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -701,6 +849,7 @@ init_thread(struct thread *t, const char *name, int priority)
 	/* 4BSD */
 	t->nice = NICE_DEFAULT;
 	t->recent_cpu = RECENT_CPU_DEFAULT;
+	t->mlfqs_epoch = mlfqs_epoch;
 
 	// 디버그 출력문
 	// printf("Adding thread: %s to all_list\n", t->name);
@@ -747,10 +896,47 @@ idle_thread를 반환합니다.
 static struct thread *
 next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
+	if (ready_cnt == 0)
 		return idle_thread;
-	else // ready_list의 맨 앞에서 꺼냄
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+	else // 가장 높은 우선순위 큐의 맨 앞에서 꺼냄
+	{
+		struct thread *t = list_entry(list_front(&ready_queues[ready_max_priority()]), struct thread, elem);
+		ready_remove(t);
+		return t;
+	}
+}
+
+/* Appends T to the ready queue for its priority. */
+static void
+ready_push(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back(&ready_queues[t->priority], &t->elem);
+	ready_bitmap |= (uint64_t)1 << t->priority;
+	ready_cnt++;
+}
+
+/* Removes T, which must be ready, from its ready queue. */
+static void
+ready_remove(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	list_remove(&t->elem);
+	if (list_empty(&ready_queues[t->priority]))
+		ready_bitmap &= ~((uint64_t)1 << t->priority);
+	ready_cnt--;
+}
+
+/* Returns the highest priority that has a ready thread.
+   There must be at least one ready thread. */
+static int
+ready_max_priority(void)
+{
+	ASSERT(ready_bitmap != 0);
+	return 63 - __builtin_clzll(ready_bitmap);
 }
 
 /* Use iretq to launch the thread */
@@ -918,6 +1104,9 @@ do_schedule(int status)
 		// 정정-> thread_exit()에서 해줘도 무방 THREAD_DYING 상태에 접어 든 쓰레드는 all_list에서 제거해줘도 무방하다.
 		palloc_free_page(victim); // 스레드의 메모리 해제
 	}
+	// idle 스레드가 CPU를 넘기면 멈춰 있던 tick을 따라잡는다.
+	if (thread_current() == idle_thread)
+		timer_idle_exit();
 	thread_current()->status = status; // 현재 스레드의 상태를 설정
 	schedule();						   // 스케줄링을 다시 수행
 }
@@ -1004,14 +1193,6 @@ allocate_tid(void)
 	return tid;
 }
 
-/* 두 스레드의 wakeup_tick 값을 비교하는 함수 a의 tick이 b의 tick보다 작으면 1(true), 크면 0(false) */
-bool compare_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-	struct thread *thread_a = list_entry(a, struct thread, elem);
-	struct thread *thread_b = list_entry(b, struct thread, elem);
-	return thread_a->local_tick < thread_b->local_tick;
-}
-
 // 내림차순 정렬 만드는 함수. a의 우선순위가 b의 우선순위보다 크면 1(true) 리턴. 반대의 경우 0(false) 리턴
 bool compare_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
 {
@@ -1025,23 +1206,42 @@ void preemption_priority(void) /* project 1 priority */
 {
 	// 현재 실행 중인 스레드가 idle 스레드인 경우 아무 작업도 필요하지 않으므로 함수 종료
 	// ready list가 비어 있는지 확인하고, 비어 있다면 다른 스레드가 대기 중이 아니므로 함수 종료
-	if (thread_current() == idle_thread || list_empty(&ready_list))
+	if (thread_current() == idle_thread || ready_cnt == 0)
 	{
 		return;
 	}
 
-	// ready list에서 가장 우선순위가 높은 스레드를 가리키는 포인터를 얻어옴
-	struct list_elem *first = list_front(&ready_list);
-	struct thread *first_t = list_entry(first, struct thread, elem);
-
-	// 현재 실행 중인 스레드의 우선순위가 ready list의 첫 번째 스레드의 우선순위보다 낮은지 확인
+	// 현재 실행 중인 스레드의 우선순위가 ready 스레드 중 가장 높은 우선순위보다 낮은지 확인
 	// 만약 그렇다면, 현재 스레드의 우선순위가 더 낮으므로 다른 스레드에게 CPU를 양보
-	if (!list_empty(&ready_list) && thread_current()->priority < first_t->priority)
+	if (thread_current()->priority < ready_max_priority())
 	{
 		thread_yield(); // CPU 양보
 	}
 }
 
+/* Changes T's effective priority to PRIORITY.  A ready thread
+   moves to the back of the queue for its new priority. */
+void thread_update_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level;
+
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable();
+	if (t->priority != priority)
+	{
+		if (t->status == THREAD_READY)
+		{
+			ready_remove(t);
+			t->priority = priority;
+			ready_push(t);
+		}
+		else
+			t->priority = priority;
+	}
+	intr_set_level(old_level);
+}
+
 /**
  * @brief donate_priority 함수는 대기 중인 락의 소유자에게 현재 스레드의 우선순위를 기부합니다.
  *        최대 반복 횟수까지 대기 중인 락을 따라가며 우선순위 기부를 처리합니다.
@@ -1067,7 +1267,7 @@ void donate_priority(void)
 			if (holder->priority < curr_thread->priority)
 			{
 				// 대기 중인 락의 소유자의 우선순위를 현재 스레드의 우선순위로 업데이트
-				holder->priority = curr_thread->priority;
+				thread_update_priority(holder, curr_thread->priority);
 			}
 
 			// 대기 중인 락의 소유자를 현재 스레드로 설정하여 다음 반복을 위해 준비
@@ -1105,54 +1305,87 @@ void refresh_priority(void)
 {
 	struct thread *curr_thread = thread_current();
 
-	curr_thread->priority = curr_thread->original_priority; // 현재 donation 받은 우선순위를 원래 자신의 우선순위로 바꾸기
+	int priority = curr_thread->original_priority; // 현재 donation 받은 우선순위를 원래 자신의 우선순위로 바꾸기
 
 	if (!list_empty(&curr_thread->donations))						// 현재 스레드에게 기부된 우선순위가 있는지 확인
 	{																// donations list가 비어 있지 않다면(아직 우선순위를 줄 스레드가 있다면)
 		list_sort(&curr_thread->donations, compare_priority, NULL); // donations 내림차순으로 정렬(가장 큰 우선순위 맨 앞으로)
 
 		struct thread *front = list_entry(list_front(&curr_thread->donations), struct thread, donation_elem); // 가장 높은 우선순위를 가진 스레드를 가져옴
-		if (front->priority > curr_thread->priority)														  // 가장 높은 우선순위가 현재 스레드의 우선순위보다 높으면
+		if (front->priority > priority)																	  // 가장 높은 우선순위가 현재 스레드의 우선순위보다 높으면
 		{
-			curr_thread->priority = front->priority; // 현재 스레드의 우선순위를 가장 높은 우선순위로 업데이트
+			priority = front->priority; // 현재 스레드의 우선순위를 가장 높은 우선순위로 업데이트
 		}
 	}
+	thread_update_priority(curr_thread, priority);
 }
 
 /* 4BSD */
 
 /* 스레드의 우선순위를 계산하는 함수.
-   t->priority = PRI_MAX - (t->recent_cpu / 4) - (t->nice * 2) */
+   t->priority = PRI_MAX - (t->recent_cpu / 4) - (t->nice * 2)
+   ready 큐의 인덱스이므로 PRI_MIN..PRI_MAX로 자른다. */
 void mlfqs_calculate_priority(struct thread *t)
 {
-	t->priority = PRI_MAX - CONVERT_FP_TO_INT_NEAR(t->recent_cpu / 4) - (t->nice * 2);
+	int priority = PRI_MAX - CONVERT_FP_TO_INT_NEAR(t->recent_cpu / 4) - (t->nice * 2);
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	thread_update_priority(t, priority);
 }
 
-/* 스레드의 최근 CPU 사용량을 계산하는 함수.
-   decay = (2 * load_avg) / (2 * load_avg + 1)
-   t->recent_cpu = decay * t->recent_cpu + t->nice */
-void mlfqs_calculate_recent_cpu(struct thread *t)
+/* 스레드의 최근 CPU 사용량에 한 번의 감쇠를 적용하는 함수.
+   t->recent_cpu = decay * t->recent_cpu + t->nice
+   우선순위는 다음 mlfqs_recalculate_priority()에서 다시 계산한다. */
+static void
+mlfqs_decay(struct thread *t, int decay)
 {
-	int decay = DIV_FP((load_avg * 2), ADD_FP_INT((load_avg * 2), 1));
 	t->recent_cpu = ADD_FP_INT(MUL_FP(decay, t->recent_cpu), t->nice);
+	t->mlfqs_epoch++;
+}
+
+/* T를 mlfqs_dirty 리스트에 넣는다. 인터럽트는 꺼져 있어야 한다. */
+static void
+mlfqs_mark_dirty(struct thread *t)
+{
+	if (!t->mlfqs_dirty)
+	{
+		t->mlfqs_dirty = true;
+		list_push_back(&mlfqs_dirty, &t->mlfqs_elem);
+	}
+}
+
+/* 잠들어 있던 스레드 T에 그동안 밀린 감쇠를 차례로 적용하고 우선순위를 다시 계산한다.
+   매초 모든 스레드를 감쇠시킨 것과 같은 값이 된다. 단, MLFQS_HISTORY초보다 오래
+   잤으면 마지막 MLFQS_HISTORY번만 적용한다. (그 전의 값은 그만큼 감쇠되면 거의 남지 않는다) */
+void mlfqs_catch_up(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (t->mlfqs_epoch < mlfqs_epoch - MLFQS_HISTORY)
+		t->mlfqs_epoch = mlfqs_epoch - MLFQS_HISTORY;
+	while (t->mlfqs_epoch < mlfqs_epoch)
+		mlfqs_decay(t, mlfqs_decay_hist[t->mlfqs_epoch % MLFQS_HISTORY]);
+	if (t != idle_thread)
+		mlfqs_calculate_priority(t);
 }
 
 /* 평균 부하량(load_avg)을 계산하는 함수.
    load_avg = (59 / 60) * load_avg + (1 / 60) * ready_threads */
 void mlfqs_calculate_load_avg(void)
 {
-	// int ready_threads = list_size(&ready_list);
 	int ready_threads;
 
 	/* 현재 실행 중인 스레드가 idle_thread인지 확인
 	   idle_thread는 CPU가 유휴 상태임을 나타냅니다. */
 	if (thread_current() == idle_thread)
-		/* CPU가 유휴 상태인 경우, ready_list에 있는 스레드 수를 그대로 사용 */
-		ready_threads = list_size(&ready_list);
+		/* CPU가 유휴 상태인 경우, ready 큐에 있는 스레드 수를 그대로 사용 */
+		ready_threads = ready_cnt;
 	else
 		/* CPU가 유휴 상태가 아닌 경우, 현재 실행 중인 스레드도 준비 상태로 간주
-		   따라서, ready_list에 있는 스레드 수에 1을 더함 */
-		ready_threads = list_size(&ready_list) + 1;
+		   따라서, ready 큐에 있는 스레드 수에 1을 더함 */
+		ready_threads = ready_cnt + 1;
 
 	// load_avg = MUL_FP(DIV_FP(CONVERT_INT_TO_FP(59), CONVERT_INT_TO_FP(60)), load_avg) + DIV_FP(CONVERT_INT_TO_FP(1), CONVERT_INT_TO_FP(60)) * ready_threads;
 	// 위와 같음
@@ -1163,33 +1396,60 @@ void mlfqs_calculate_load_avg(void)
    idle 스레드가 아닌 경우 현재 실행 중인 스레드의 recent_cpu를 1 증가시킴 */
 void mlfqs_increase_recent_cpu(void)
 {
-	if (thread_current() != idle_thread)
+	struct thread *t = thread_current();
+
+	if (t != idle_thread)
 	{
-		// printf("not idle\n");
-		thread_current()->recent_cpu = ADD_FP_INT(thread_current()->recent_cpu, 1);
+		t->recent_cpu = ADD_FP_INT(t->recent_cpu, 1);
+		mlfqs_mark_dirty(t);
 	}
 }
 
-/* 모든 스레드의 우선순위를 재계산하는 함수. */
+/* recent_cpu나 nice가 바뀐 스레드들의 우선순위를 재계산하는 함수.
+   입력이 그대로인 스레드는 다시 계산해도 같은 값이므로 건너뛴다. */
 void mlfqs_recalculate_priority(void)
 {
-	struct list_elem *e;
+	ASSERT(intr_get_level() == INTR_OFF);
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	while (!list_empty(&mlfqs_dirty))
 	{
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		mlfqs_calculate_priority(t);
+		struct thread *t = list_entry(list_pop_front(&mlfqs_dirty), struct thread, mlfqs_elem);
+		t->mlfqs_dirty = false;
+		if (t != idle_thread)
+			mlfqs_calculate_priority(t);
 	}
 }
 
-/* 모든 스레드의 최근 CPU 사용량을 재계산하는 함수. */
+/* 매초 최근 CPU 사용량을 감쇠시키는 함수.
+   decay = (2 * load_avg) / (2 * load_avg + 1)
+   실행 중이거나 ready 큐에 있는 스레드에만 바로 적용하고, 잠든 스레드는
+   깨어날 때 mlfqs_catch_up()이 이번 감쇠까지 적용한다. */
 void mlfqs_recalculate_recent_cpu(void)
 {
-	struct list_elem *e;
+	int decay = DIV_FP((load_avg * 2), ADD_FP_INT((load_avg * 2), 1));
+	struct thread *curr = thread_current();
+	uint64_t bits;
 
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	mlfqs_decay_hist[mlfqs_epoch % MLFQS_HISTORY] = decay;
+	mlfqs_epoch++;
+
+	if (curr != idle_thread)
 	{
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		mlfqs_calculate_recent_cpu(t);
+		mlfqs_decay(curr, decay);
+		mlfqs_mark_dirty(curr);
+	}
+	for (bits = ready_bitmap; bits != 0; bits &= bits - 1)
+	{
+		struct list *q = &ready_queues[__builtin_ctzll(bits)];
+		struct list_elem *e;
+
+		for (e = list_begin(q); e != list_end(q); e = list_next(e))
+		{
+			struct thread *t = list_entry(e, struct thread, elem);
+			mlfqs_decay(t, decay);
+			mlfqs_mark_dirty(t);
+		}
 	}
 }
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
@@ -11,6 +12,17 @@ static long long page_fault_cnt;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
+static bool fixup_exception(struct intr_frame *);
+
+/* Exception fixup table entry: a fault at INSN resumes at FIXUP.
+   Entries are emitted by EXCEPTION_FIXUP into the .ex_table
+   section, which the linker script brackets with these symbols. */
+struct exception_fixup
+{
+	uint64_t insn;
+	uint64_t fixup;
+};
+extern const struct exception_fixup __ex_table_start[], __ex_table_end[];
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -145,13 +157,31 @@ page_fault(struct intr_frame *f)
 
 #ifdef VM
 	/* For project 3 and later. */
-	if (vm_try_handle_fault(f, fault_addr, user, write, not_present))
+	bool handled = vm_try_handle_fault(f, fault_addr, user, write, not_present);
+
+	/* A process chosen by the OOM killer dies quietly.  A fault
+	   from user mode holds no kernel locks, so this is a safe
+	   point to exit.  A fault taken inside a system call falls
+	   through to the fixup below; the system call then fails and
+	   the process exits on its way back to user mode. */
+	if (user && thread_current()->oom_killed)
+	{
+		exit(-1);
+	}
+	if (handled)
 	{
 		return;
 	}
 
 #endif
 
+	/* A kernel access to user memory through one of the
+	   fault-tolerant copy routines just stops early. */
+	if (!user && fixup_exception(f))
+	{
+		return;
+	}
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
@@ -167,3 +197,22 @@ page_fault(struct intr_frame *f)
 	exit(-1);
 	kill(f);
 }
+
+/* If F's faulting instruction has an entry in the exception
+   fixup table, makes F resume at the entry's fixup address and
+   returns true.  Returns false otherwise. */
+static bool
+fixup_exception(struct intr_frame *f)
+{
+	const struct exception_fixup *e;
+
+	for (e = __ex_table_start; e < __ex_table_end; e++)
+	{
+		if (e->insn == f->rip)
+		{
+			f->rip = e->fixup;
+			return true;
+		}
+	}
+	return false;
+}
@@ -999,41 +999,12 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT(pg_ofs(upage) == 0);
 	ASSERT(ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0)
-	{
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-
-		void *aux = NULL;
-		lazy_load_info *aux_info = malloc(sizeof(struct lazy_load_info_t));
-		if (aux_info == NULL)
-		{
-			return false;
-		}
-		aux_info->file = file;
-		aux_info->offset = ofs;
-		aux_info->read_bytes = page_read_bytes;
-		aux_info->zero_bytes = page_zero_bytes;
-
-		aux = aux_info;
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-											writable, lazy_load_segment, aux))
-		{
-			return false;
-		}
-
-		/* Advance. */
-		ofs += page_read_bytes;
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-	}
-	return true;
+	/* 세그먼트 전체를 영역 하나로 등록한다. 페이지는 처음 접근할 때 만들어진다.
+	 * 파일 내용이 있는 페이지는 lazy_load_segment로 읽고, 나머지(BSS)는 zero page로 시작한다.
+	 * 읽기 전용 세그먼트는 같은 실행 파일을 돌리는 프로세스끼리 프레임을 공유한다. */
+	enum vm_type type = writable ? VM_ANON : VM_ANON | VM_TEXT;
+	return vma_map(&thread_current()->spt, upage, read_bytes + zero_bytes, type, writable,
+				   lazy_load_segment, file, ofs, read_bytes) != NULL;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -1046,7 +1017,9 @@ setup_stack(struct intr_frame *if_)
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
-	if (vm_alloc_page(VM_MARKER_0 | VM_ANON, stack_bottom, true))
+	// 스택도 영역 하나로 두고, 스택 성장은 영역의 시작을 아래로 내린다.
+	if (vma_map(&thread_current()->spt, stack_bottom, PGSIZE, VM_MARKER_0 | VM_ANON | VM_ZERO, true,
+				NULL, NULL, 0, 0))
 	{
 		// printf(“vm_alloc_page stack 성공\nstack_pointer : %p\n\n”, USER_STACK); /* Debug */
 		success = vm_claim_page(stack_bottom);
@@ -15,12 +15,22 @@
 #include "filesys/file.h"
 #include "threads/palloc.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 
 void syscall_entry(void);
+
+// 이보다 작은 read/write 버퍼는 커널 스택의 버퍼로 한 번에 복사한다. 고정(pin)하려고 락을 잡는 것보다 싸다.
+#define SYSCALL_BOUNCE_SIZE 256
+// 큰 버퍼는 이만큼씩 고정해서 읽고 쓴다. 한 번에 user pool을 모두 고정하지 않도록.
+#define SYSCALL_PIN_CHUNK (64 * PGSIZE)
+// create/remove/open이 커널 스택에 복사하는 파일 이름의 최대 길이 (널 문자 포함)
+#define SYSCALL_PATH_MAX 128
 void syscall_handler(struct intr_frame *);
 
 void check_address(void *addr);
+static bool copy_path_from_user(char *dst, const char *upath);
 void get_argument(void *rsp, int *argv, int argc);
 // int add_file_descriptor(struct file *f);
 // struct file *get_file_from_fdt(int fd);
@@ -46,6 +56,8 @@ void close(int fd);
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
 /*---------------------------------------------------------------*/
+int64_t clock_gettime(int clock_id);
+int clock_nanosleep(int clock_id, int64_t ns);
 
 /* System call.
  *
@@ -92,6 +104,14 @@ void syscall_handler(struct intr_frame *f UNUSED)
 		6번째 인자: %r9
 	*/
 
+#ifdef VM
+	// OOM killer에게 선택된 프로세스는 다음 시스템 콜에서 끝낸다.
+	if (thread_current()->oom_killed)
+	{
+		exit(-1);
+	}
+#endif
+
 	// Getting the system call number from the interrupt frame /* %rax 는 시스템 콜 번호 */
 	int syscall_number = f->R.rax;
 
@@ -157,6 +177,12 @@ void syscall_handler(struct intr_frame *f UNUSED)
 		munmap((void *)f->R.rdi);
 		lock_release(&filesys_lock);
 		break;
+	case SYS_CLOCK_GETTIME: /* Read a clock. */
+		f->R.rax = clock_gettime((int)f->R.rdi);
+		break;
+	case SYS_CLOCK_NANOSLEEP: /* Sleep on a clock. */
+		f->R.rax = clock_nanosleep((int)f->R.rdi, (int64_t)f->R.rsi);
+		break;
 
 	// case SYS_DUP2: /* 구현 실패... */
 	// 	dup2((int)f->R.rdi, (int)f->R.rsi);
@@ -166,6 +192,27 @@ void syscall_handler(struct intr_frame *f UNUSED)
 		printf("Unknown system call: %d\n", syscall_number);
 		thread_exit();
 	}
+
+#ifdef VM
+	// 시스템 콜 도중 OOM killer에게 선택됐으면 유저로 돌아가기 전에 끝낸다. 잡았던 락은 모두 놓은 뒤다.
+	if (thread_current()->oom_killed)
+	{
+		exit(-1);
+	}
+#endif
+}
+
+/* 유저의 파일 이름 UPATH를 커널 버퍼 DST(SYSCALL_PATH_MAX 바이트)로 복사한다.
+ * filesys_lock을 잡기 전에 불러서, 락을 잡은 채로 유저 메모리를 읽다가 폴트로 끝나는 일이 없게 한다.
+ * 읽을 수 없는 주소면 exit(-1), 이름이 너무 길면 false. */
+static bool copy_path_from_user(char *dst, const char *upath)
+{
+	long len = strncpy_from_user(dst, upath, SYSCALL_PATH_MAX);
+	if (len < 0)
+	{
+		exit(-1);
+	}
+	return len < SYSCALL_PATH_MAX;
 }
 
 /* Check if the address is in user space */
@@ -173,7 +220,7 @@ void check_address(void *addr)
 {
 	// 포인터가 가리키는 주소가 유저 영역의 주소인지 확인
 	// 주어진 주소가 현재 프로세스의 페이지 테이블에 유효하게 매핑되어 있는지 확인
-	if (addr == NULL || !is_user_vaddr(addr) || spt_find_page(&thread_current()->spt, addr) == NULL)
+	if (addr == NULL || !is_user_vaddr(addr) || vma_find(&thread_current()->spt, addr) == NULL)
 	{
 		// 잘못된 접근일 경우 프로세스 종료
 		exit(-1);
@@ -314,7 +361,14 @@ int exec(const char *cmd_line)
 	}
 
 	// 명령어 줄을 새로 할당한 메모리 페이지에 복사합니다.
-	strlcpy(cl_copy, cmd_line, PGSIZE);
+	// 폴트가 나도 커널이 죽지 않는 복사 함수를 쓴다. 너무 길면 strlcpy처럼 자른다.
+	long len = strncpy_from_user(cl_copy, cmd_line, PGSIZE);
+	if (len < 0)
+	{
+		palloc_free_page(cl_copy);
+		exit(-1);
+	}
+	cl_copy[PGSIZE - 1] = '\0';
 
 	// 복사된 명령어 줄을 사용하여 새로운 프로세스를 실행합니다.
 	// 실행에 실패하면 상태 -1로 프로세스를 종료합니다.
@@ -346,6 +400,11 @@ bool create(const char *file, unsigned initial_size)
 	/* 파일 이름과 크기에 해당하는 파일 생성 */
 	/* 파일 생성 성공 시 true 반환, 실패 시 false 반환 */
 	check_address((void *)file);
+	char name[SYSCALL_PATH_MAX];
+	if (!copy_path_from_user(name, file))
+	{
+		return false;
+	}
 	// 실제 파일 시스템 호출로 변경 필요
 	bool flag = false;
 	// merger test lock
@@ -354,7 +413,7 @@ bool create(const char *file, unsigned initial_size)
 		lock_acquire(&filesys_lock);
 		flag = true;
 	}
-	bool result = filesys_create(file, initial_size);
+	bool result = filesys_create(name, initial_size);
 	if (flag)
 	{
 		flag = false;
@@ -380,6 +439,11 @@ bool remove(const char *file)
 	/* 파일 이름에 해당하는 파일을 제거 */
 	/* 파일 제거 성공 시 true 반환, 실패 시 false 반환 */
 	check_address((void *)file);
+	char name[SYSCALL_PATH_MAX];
+	if (!copy_path_from_user(name, file))
+	{
+		return false;
+	}
 
 	bool flag = false;
 	// merger test lock
@@ -388,7 +452,7 @@ bool remove(const char *file)
 		lock_acquire(&filesys_lock);
 		flag = true;
 	}
-	bool result = filesys_remove(file);
+	bool result = filesys_remove(name);
 	if (flag)
 	{
 		flag = false;
@@ -411,6 +475,11 @@ int open(const char *file)
 
 	check_address(file); // 주어진 파일 이름 주소가 유효한지 확인합니다.
 						 // printf("오픈이 오류나나222222?\n");
+	char name[SYSCALL_PATH_MAX];
+	if (!copy_path_from_user(name, file))
+	{
+		return -1;
+	}
 
 	struct file *f;
 	// merger test lock
@@ -420,7 +489,7 @@ int open(const char *file)
 		lock_acquire(&filesys_lock);
 		flag = true;
 	}
-	f = filesys_open(file); // 파일 시스템에서 파일을 엽니다.
+	f = filesys_open(name); // 파일 시스템에서 파일을 엽니다.
 	if (flag)
 	{
 		flag = false;
@@ -498,20 +567,22 @@ int read(int fd, void *buffer, unsigned size)
 {
 	check_address(buffer); // 주어진 버퍼 주소가 유효한지 확인합니다.
 	// 버퍼가 읽기 전용이면 종료 -ptr-write-code2
-	if (spt_find_page(&thread_current()->spt, buffer)->writable == false)
+	if (vma_find(&thread_current()->spt, buffer)->writable == false)
 	{
 		exit(-1);
 	}
 
 	off_t read_byte;
-	uint8_t *read_buffer = buffer;
 	if (fd == STDIN_FILENO)
 	{
 		char key;
 		for (read_byte = 0; read_byte < size; read_byte++)
 		{
 			key = input_getc();
-			*read_buffer++ = key;
+			if (copy_to_user((uint8_t *)buffer + read_byte, &key, 1) != 0)
+			{
+				exit(-1);
+			}
 			if (key == '\0')
 			{
 				break;
@@ -531,19 +602,41 @@ int read(int fd, void *buffer, unsigned size)
 			return -1; // 파일이 열려 있지 않은 경우 -1을 반환합니다.
 		}
 
-		bool flag = false;
-		// merger test lock
-		if (!lock_held_by_current_thread(&filesys_lock))
+		// 작은 버퍼는 커널 버퍼로 읽은 뒤 락을 놓고 복사한다.
+		if (size <= SYSCALL_BOUNCE_SIZE)
 		{
+			char kbuf[SYSCALL_BOUNCE_SIZE];
 			lock_acquire(&filesys_lock);
-			flag = true;
+			read_byte = file_read(f, kbuf, size);
+			lock_release(&filesys_lock);
+			if (copy_to_user(buffer, kbuf, read_byte) != 0)
+			{
+				exit(-1);
+			}
+			return read_byte;
 		}
-		read_byte = file_read(f, buffer, size);
 
-		if (flag)
+		// 큰 버퍼는 고정한 유저 페이지에 파일 내용을 바로 읽어 넣는다.
+		// 고정된 페이지는 쫓겨나지 않으므로 file_read 도중 폴트가 나지 않는다.
+		read_byte = 0;
+		while ((unsigned)read_byte < size)
 		{
-			flag = false;
+			uint8_t *chunk = (uint8_t *)buffer + read_byte;
+			size_t chunk_size = size - read_byte < SYSCALL_PIN_CHUNK ? size - read_byte : SYSCALL_PIN_CHUNK;
+			if (!vm_pin_range(chunk, chunk_size, true))
+			{
+				exit(-1);
+			}
+			lock_acquire(&filesys_lock);
+			off_t n = file_read(f, chunk, chunk_size);
 			lock_release(&filesys_lock);
+			vm_unpin_range(chunk, chunk_size);
+
+			read_byte += n;
+			if ((size_t)n < chunk_size)
+			{
+				break;
+			}
 		}
 	}
 	return read_byte; // 파일에서 데이터를 읽고, 읽은 바이트 수를 반환합니다.
@@ -561,38 +654,70 @@ int write(int fd, const void *buffer, unsigned size)
 {
 	check_address((void *)buffer); // 주어진 버퍼 주소가 유효한지 확인합니다.
 
-	off_t write_byte;
 	if (fd == STDIN_FILENO)
 	{
 		return -1;
 	}
-	else if (fd == STDOUT_FILENO)
-	{
-		putbuf(buffer, size); // 표준 출력에 데이터를 씁니다.
-		return size;		  // 쓴 바이트 수를 반환합니다.
-	}
-	else
+
+	struct file *f = NULL;
+	if (fd != STDOUT_FILENO)
 	{
 		// struct file *f = thread_current()->fd_table[fd]; // 파일 디스크립터 테이블에서 파일 포인터를 가져옵니다.
-		struct file *f = get_file_from_fdt(fd);
+		f = get_file_from_fdt(fd);
 		if (!f)
 		{
 			return -1; // 파일이 열려 있지 않은 경우 -1을 반환합니다.
 		}
+	}
 
-		bool flag = false;
-		// merger test lock
-		if (!lock_held_by_current_thread(&filesys_lock))
+	// 작은 버퍼는 먼저 커널 버퍼로 복사한다. 폴트는 락을 잡기 전에 복사하면서 처리된다.
+	if (size <= SYSCALL_BOUNCE_SIZE)
+	{
+		char kbuf[SYSCALL_BOUNCE_SIZE];
+		if (copy_from_user(kbuf, buffer, size) != 0)
 		{
-			lock_acquire(&filesys_lock);
-			flag = true;
+			exit(-1);
 		}
-		write_byte = file_write(f, buffer, size);
-		if (flag)
+		if (f == NULL)
 		{
-			flag = false;
+			putbuf(kbuf, size); // 표준 출력에 데이터를 씁니다.
+			return size;		// 쓴 바이트 수를 반환합니다.
+		}
+		lock_acquire(&filesys_lock);
+		off_t write_byte = file_write(f, kbuf, size);
+		lock_release(&filesys_lock);
+		return write_byte;
+	}
+
+	// 큰 버퍼는 고정한 유저 페이지에서 바로 쓴다.
+	off_t write_byte = 0;
+	while ((unsigned)write_byte < size)
+	{
+		const uint8_t *chunk = (const uint8_t *)buffer + write_byte;
+		size_t chunk_size = size - write_byte < SYSCALL_PIN_CHUNK ? size - write_byte : SYSCALL_PIN_CHUNK;
+		if (!vm_pin_range(chunk, chunk_size, false))
+		{
+			exit(-1);
+		}
+		off_t n;
+		if (f == NULL)
+		{
+			putbuf((const char *)chunk, chunk_size);
+			n = chunk_size;
+		}
+		else
+		{
+			lock_acquire(&filesys_lock);
+			n = file_write(f, chunk, chunk_size);
 			lock_release(&filesys_lock);
 		}
+		vm_unpin_range(chunk, chunk_size);
+
+		write_byte += n;
+		if ((size_t)n < chunk_size)
+		{
+			break;
+		}
 	}
 	return write_byte; // 파일에 데이터를 쓰고, 쓴 바이트 수를 반환합니다.
 }
@@ -701,6 +826,17 @@ void close(int fd)
 
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 {
+	// 익명 매핑은 파일 검사 없이 주소만 확인한다. 주소를 정하지 않으면(NULL) 커널이 고른다.
+	if (writable & MAP_ANONYMOUS)
+	{
+		if (length == 0 || pg_ofs(addr) != 0 ||
+			(addr != NULL && (is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length - 1) || addr + length < addr)))
+		{
+			return NULL;
+		}
+		return do_mmap_anon(addr, length, (writable & MAP_WRITE) != 0, (writable & MAP_SHARED) != 0);
+	}
+
 	/* 커널 주소 접근 예외처리*/
 	if (is_kernel_vaddr(addr) || is_kernel_vaddr(addr - length))
 	{
@@ -759,15 +895,10 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 		lock_release(&filesys_lock);
 	}
 
-	void *check_addr = addr;
-	/* 중복된 페이지가 있는지 검사 -> while문으로 확인*/
-	while (check_addr < (length + addr))
+	/* 이미 쓰고 있는 영역과 겹치는지 검사 */
+	if (vma_overlaps(&thread_current()->spt, addr, addr + length))
 	{
-		if (spt_find_page(&thread_current()->spt, check_addr))
-		{
-			return NULL;
-		}
-		check_addr += PGSIZE;
+		return NULL;
 	}
 
 	/* addr이 정렬된 페이지인지 확인*/
@@ -783,7 +914,7 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 	}
 
 	// 유효한 주소이면 do_mmap() 호출
-	if (do_mmap(addr, length, writable, get_file_from_fdt(fd), offset))
+	if (do_mmap(addr, length, writable & MAP_WRITE, get_file_from_fdt(fd), offset))
 	{
 		// printf("addr: %p\n", addr);
 		return addr;
@@ -803,6 +934,44 @@ void munmap(void *addr)
 	do_munmap(addr);
 }
 
+/**
+ * @brief Reads a clock.
+ *
+ * The user library splits the result into a struct timespec.
+ *
+ * @param clock_id The clock to read. Only CLOCK_MONOTONIC is supported.
+ * @return Nanoseconds since boot, or -1 if CLOCK_ID is not supported.
+ */
+int64_t clock_gettime(int clock_id)
+{
+	if (clock_id != CLOCK_MONOTONIC)
+	{
+		return -1;
+	}
+	return timer_now_ns();
+}
+
+/**
+ * @brief Sleeps for at least a number of nanoseconds.
+ *
+ * The user library passes the struct timespec as nanoseconds. The sleep
+ * is rounded up to whole timer ticks and blocks in timer_sleep(), so
+ * other threads run in the meantime.
+ *
+ * @param clock_id The clock to sleep on. Only CLOCK_MONOTONIC is supported.
+ * @param ns Nanoseconds to sleep.
+ * @return 0, or -1 if CLOCK_ID is not supported or NS is negative.
+ */
+int clock_nanosleep(int clock_id, int64_t ns)
+{
+	if (clock_id != CLOCK_MONOTONIC || ns < 0)
+	{
+		return -1;
+	}
+	timer_sleep(DIV_ROUND_UP(ns, 1000000000 / TIMER_FREQ));
+	return 0;
+}
+
 // /**
 //  * @brief Duplicates an existing file descriptor to a new file descriptor.
 //  *
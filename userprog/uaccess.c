@@ -0,0 +1,88 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include <string.h>
+#include "threads/vaddr.h"
+#include "userprog/exception.h"
+
+/* Copies SIZE bytes from SRC to DST with a single "rep movsb".
+   If a page fault that the VM cannot resolve interrupts the copy,
+   the exception fixup table sends it to the end of the copy with
+   RCX still holding the count of bytes left, so a bad user
+   pointer makes the copy stop short instead of killing the
+   kernel.  Returns the number of bytes NOT copied. */
+static size_t
+user_copy (void *dst, const void *src, size_t size)
+{
+	__asm__ volatile ("1: rep movsb\n\t"
+			  "2:\n\t"
+			  EXCEPTION_FIXUP (1b, 2b)
+			  : "+c" (size), "+D" (dst), "+S" (src)
+			  :
+			  : "memory");
+	return size;
+}
+
+/* Returns true if [UADDR, UADDR + SIZE) lies entirely in user
+   space.  The pages need not be mapped. */
+bool
+user_range_ok (const void *uaddr, size_t size)
+{
+	uintptr_t start = (uintptr_t) uaddr;
+
+	if (size == 0)
+		return true;
+	return uaddr != NULL && start + size > start
+		&& is_user_vaddr (uaddr) && is_user_vaddr ((void *) (start + size - 1));
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Pages that are not loaded yet are faulted in as usual.
+   Returns the number of bytes that could not be copied, 0 on
+   success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+	if (!user_range_ok (usrc, size))
+		return size;
+	return user_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns the number of bytes that could not be copied, 0 on
+   success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size)
+{
+	if (!user_range_ok (udst, size))
+		return size;
+	return user_copy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   kernel buffer DST, which holds SIZE bytes.  Copies at most up
+   to the next page boundary at a time, so it never touches a
+   page past the end of the string.  Returns the length of the
+   string, not counting the null terminator; SIZE if the first
+   SIZE bytes hold no null terminator, in which case DST is not
+   terminated; or -1 if USRC cannot be read. */
+long
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+	size_t copied = 0;
+
+	while (copied < size) {
+		const char *src = usrc + copied;
+		size_t chunk = PGSIZE - pg_ofs (src);
+		char *nul;
+
+		if (chunk > size - copied)
+			chunk = size - copied;
+		if (!user_range_ok (src, chunk) || user_copy (dst + copied, src, chunk) != 0)
+			return -1;
+		nul = memchr (dst + copied, '\0', chunk);
+		if (nul != NULL)
+			return nul - dst;
+		copied += chunk;
+	}
+	return size;
+}
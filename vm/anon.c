@@ -6,6 +6,7 @@
 #include "lib/kernel/list.h"
 #include "include/threads/mmu.h"
 #include "threads/malloc.h"
+#include "userprog/process.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -23,12 +24,36 @@ static const struct page_operations anon_ops = {
 
 struct swap_table swap_table; // 스왑테이블 전역변수 선언
 
+// 스왑 슬롯 하나(한 페이지)를 명령 한 번으로 읽고 쓴다.
+static void
+swap_read_page(size_t sw_idx, void *kva)
+{
+	disk_read_multiple(swap_disk, sw_idx, kva, SECTORS_PER_PAGE);
+	vm_stats.swap_in_cnt++;
+}
+
+static void
+swap_write_page(size_t sw_idx, const void *kva)
+{
+	disk_write_multiple(swap_disk, sw_idx, kva, SECTORS_PER_PAGE);
+	vm_stats.swap_out_cnt++;
+}
+
 /* Initialize the data for anonymous pages */
 void vm_anon_init(void)
 {
 	/* TODO: Set up the swap_disk. */
 	swap_disk = disk_get(1, 1);
 	swap_table.sb = bitmap_create(disk_size(swap_disk)); // 스왑테이블 비트맵 할당
+	swap_table.slot_cnt = disk_size(swap_disk) / SECTORS_PER_PAGE;
+	swap_table.used_cnt = 0;
+	swap_table.hint = 0;
+	swap_table.refs = calloc(swap_table.slot_cnt, sizeof *swap_table.refs);
+	if (swap_table.refs == NULL)
+	{
+		PANIC("swap: 슬롯 참조 수 배열을 할당할 수 없음");
+	}
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -36,7 +61,7 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva)
 {
 	/* Set up the handler */
 	page->operations = &anon_ops;
-	page->anon.type = VM_ANON;
+	page->anon.type = type; // VM_TEXT 등의 마커를 유지 (fork 때 uninit으로 복사할 수 있도록)
 	struct anon_page *anon_page = &page->anon;
 
 	/*----swaping------*/
@@ -51,61 +76,211 @@ anon_swap_in(struct page *page, void *kva)
 {
 	struct anon_page *anon_page = &page->anon;
 
-	// bitmap_reset(swap_table.sb, page->sw_idx);
-	// bitmap_set(swap_table.sb, swap_slot_idx, false);
-
-	bitmap_set_multiple(swap_table.sb, page->sw_idx, 8, false);
-
-	// 디스크 리드는 섹터 단위로 수행됩니다; 한 페이지를 읽을 때까지 반복합니다.
-	for (int i = 0; i < 8; i++)
+	// 압축 스왑 캐시에 있으면 디스크를 읽지 않고 푼다.
+	if (page->zswap != NULL)
 	{
-		disk_read(swap_disk, page->sw_idx + i, (char *)(page->frame->kva) + DISK_SECTOR_SIZE * i);
+		zswap_load(page, kva);
+	}
+	else
+	{
+		// 한 페이지 분량의 섹터를 한 번에 읽습니다.
+		swap_read_page(page->sw_idx, kva);
+
+		// 다시 쫓겨날 때까지 고치지 않으면 슬롯의 내용을 그대로 쓸 수 있으므로 남겨 둔다.
+		// 스왑 공간이 절반 넘게 차면 새로 쫓겨나는 페이지를 위해 바로 돌려준다.
+		if (swap_table.used_cnt * 2 > swap_table.slot_cnt)
+		{
+			anon_forget_slot(page);
+		}
 	}
 
 	/*----------------------------------*/
 	// 가상 주소 연결을 복구합니다.
-	pml4_set_page(thread_current()->pml4, page->va, kva, true); // 쓰기 가능으로 설정합니다.
+	pml4_set_page(thread_current()->pml4, page->va, kva, page->writable); // 원래 쓰기 권한으로 설정합니다.
 	page->is_loaded = true;
 	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
-static bool
-anon_swap_out(struct page *page)
+// PAGE를 쓸 빈 슬롯을 고른다. 같은 프로세스의 바로 앞 페이지가 방금 쓰인 슬롯의 다음 슬롯이
+// 비어 있으면 그 자리를 쓰고, 아니면 SWAP_CLUSTER 페이지가 통째로 빈 새 묶음의 처음을 잡는다.
+// 그래서 가상 주소로 이웃한 페이지들이 디스크에서도 이어지고, 스왑인 때 한 번에 읽힌다.
+static size_t
+swap_slot_alloc(struct page *page)
 {
-	struct anon_page *anon_page = &page->anon;
-	// 여유 swap slot 탐색 = bitmap을 first-fit 알고리즘을 이용하여 탐색
-	size_t idx = bitmap_scan_and_flip(swap_table.sb, 0, 8, false);
+	struct supplemental_page_table *spt = &page->thread->spt;
+	size_t idx = BITMAP_ERROR;
+
+	if (page->va == spt->swap_next_va && spt->swap_next_idx + SECTORS_PER_PAGE <= bitmap_size(swap_table.sb) &&
+		!bitmap_contains(swap_table.sb, spt->swap_next_idx, SECTORS_PER_PAGE, true))
+	{
+		idx = spt->swap_next_idx;
+	}
+	if (idx == BITMAP_ERROR)
+	{
+		// 새 묶음은 지난 묶음 뒤에서부터 찾아 다른 프로세스의 묶음을 건너뛴다.
+		size_t cluster = SWAP_CLUSTER * SECTORS_PER_PAGE;
+		idx = bitmap_scan(swap_table.sb, swap_table.hint, cluster, false);
+		if (idx == BITMAP_ERROR)
+		{
+			idx = bitmap_scan(swap_table.sb, 0, cluster, false);
+		}
+		if (idx != BITMAP_ERROR)
+		{
+			swap_table.hint = idx + cluster;
+		}
+	}
+	if (idx == BITMAP_ERROR)
+	{
+		// 빈 묶음이 없으면 first-fit으로 아무 슬롯이나 쓴다.
+		idx = bitmap_scan(swap_table.sb, 0, SECTORS_PER_PAGE, false);
+		if (idx == BITMAP_ERROR)
+		{
+			return BITMAP_ERROR;
+		}
+	}
+
+	bitmap_set_multiple(swap_table.sb, idx, SECTORS_PER_PAGE, true);
+	spt->swap_next_va = page->va + PGSIZE;
+	spt->swap_next_idx = idx + SECTORS_PER_PAGE;
+	return idx;
+}
+
+// 한 페이지를 스왑 디스크의 빈 슬롯에 쓰고 슬롯 번호를 PAGE에 남긴다.
+bool anon_swap_to_disk(struct page *page, const void *kva)
+{
+	size_t idx = swap_slot_alloc(page);
 	if (idx == BITMAP_ERROR)
 	{
-		PANIC("스왑아웃 실패인가?\n");
-		// printf("스왑 슬롯 찾기 실패!!\n"); // debug
 		return false;
 	}
-	// printf("selected idx: %d\n", idx);
 
-	// 디스크에 쓰기 8번 for문
-	for (int i = 0; i < 8; i++)
+	// 디스크에 한 페이지를 한 번에 쓰기
+	swap_write_page(idx, kva);
+	swap_table.refs[SWAP_SLOT(idx)] = 1;
+	page->sw_idx = idx;
+	page->sw_valid = true;
+	swap_table.used_cnt++;
+	page->thread->spt.swap_cnt++;
+	return true;
+}
+
+// PAGE가 이미 쓰인 슬롯 SW_IDX를 함께 가리키게 한다. (COW로 공유하던 프레임을 쫓아낼 때)
+void anon_share_slot(struct page *page, size_t sw_idx)
+{
+	ASSERT(!page->sw_valid);
+	ASSERT(swap_table.refs[SWAP_SLOT(sw_idx)] > 0);
+
+	swap_table.refs[SWAP_SLOT(sw_idx)]++;
+	page->sw_idx = sw_idx;
+	page->sw_valid = true;
+	page->thread->spt.swap_cnt++;
+}
+
+// PAGE가 가진 스왑 슬롯을 돌려준다. 스왑인 후 페이지를 고쳤으면 슬롯 내용은 더 이상 맞지 않는다.
+void anon_forget_slot(struct page *page)
+{
+	if (page->sw_valid)
+	{
+		page->sw_valid = false;
+		page->thread->spt.swap_cnt--;
+		anon_swap_free(page->sw_idx);
+	}
+}
+
+// 페이지 하나를 아무 빈 슬롯에 쓰고 슬롯의 첫 섹터를 반환한다. 자리가 없으면 BITMAP_ERROR.
+// 특정 프로세스의 것이 아닌 공유 익명 페이지용이라 묶음 할당을 하지 않는다.
+size_t anon_swap_write(const void *kva)
+{
+	size_t idx = bitmap_scan_and_flip(swap_table.sb, 0, SECTORS_PER_PAGE, false);
+	if (idx == BITMAP_ERROR)
 	{
-		disk_write(swap_disk, idx + i, (char *)(page->frame->kva) + i * DISK_SECTOR_SIZE);
+		return BITMAP_ERROR;
 	}
+	swap_write_page(idx, kva);
+	swap_table.refs[SWAP_SLOT(idx)] = 1;
+	swap_table.used_cnt++;
+	return idx;
+}
 
-	// pml4에서 엔트리 삭제하기
-	pml4_clear_page(page->thread->pml4, page->va);
+void anon_swap_read(size_t sw_idx, void *kva)
+{
+	swap_read_page(sw_idx, kva);
+}
 
-	// printf("anon swap out: %p\n", page->frame->kva);
-	// 물리 메모리 해제
-	// palloc_free_page(page->frame->kva);
-	// free(page->frame);
-	// 프레임 테이블에서 삭제
-	list_remove(&page->frame_elem);
-	// page->frame->page = NULL;
-	// page->frame = NULL;
+// 슬롯의 참조 하나를 놓는다. 마지막 참조였으면 슬롯을 돌려준다.
+void anon_swap_free(size_t sw_idx)
+{
+	ASSERT(swap_table.refs[SWAP_SLOT(sw_idx)] > 0);
 
-	// 페이지 스왑 슬롯 인덱스 저장
-	page->sw_idx = idx;
-	page->is_loaded = false;
+	if (--swap_table.refs[SWAP_SLOT(sw_idx)] == 0)
+	{
+		bitmap_set_multiple(swap_table.sb, sw_idx, SECTORS_PER_PAGE, false);
+		swap_table.used_cnt--;
+	}
+}
+
+/* 익명 메모리를 매핑한다. (mmap의 MAP_ANONYMOUS) ADDR이 NULL이면 스택 아래에서 빈 자리를 찾는다.
+ * 페이지는 다른 익명 페이지처럼 처음 쓸 때 만들어지고 스왑된다. SHARED면 fork한 자식과
+ * 같은 프레임을 쓰고, 아니면 fork 후 copy-on-write로 나뉜다. 실패하면 NULL. */
+void *do_mmap_anon(void *addr, size_t length, bool writable, bool shared)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	int held = vm_lock_acquire(false);
 
+	if (addr == NULL)
+	{
+		addr = vma_find_free(spt, length, (void *)USER_STACK - USER_STACK_LIMIT);
+	}
+	// 공유 영역은 zero page를 쓰지 않는다. 모든 프로세스가 처음부터 같은 프레임을 봐야 한다.
+	enum vm_type type = VM_ANON | VM_MMAP | (shared ? VM_SHARED : VM_ZERO);
+	struct vm_area *vma = addr != NULL ? vma_map(spt, addr, length, type, writable, NULL, NULL, 0, 0) : NULL;
+	if (vma != NULL && shared)
+	{
+		vma->shm = vm_shm_create((vma->end - vma->start) / PGSIZE);
+		if (vma->shm == NULL)
+		{
+			vma_unmap(spt, vma);
+			vma = NULL;
+		}
+	}
+
+	vm_lock_release(held);
+	return vma != NULL ? addr : NULL;
+}
+
+/* Swap out the page by writing contents to the swap disk. */
+static bool
+anon_swap_out(struct page *page)
+{
+	struct anon_page *anon_page = &page->anon;
+
+	// 프레임 소유자의 pml4에서 엔트리 삭제하기
+	// 쓰는 도중 소유자가 페이지를 고치지 못하도록 먼저 매핑을 끊는다. (kswapd)
+	// dirty 비트는 present 비트를 지워도 남아있다.
+	uint64_t *pml4 = page->frame->pml4;
+	pml4_clear_page(pml4, page->va);
+
+	// 스왑인 뒤로 고치지 않은 페이지는 슬롯에 같은 내용이 있으므로 쓰지 않고 버린다.
+	if (page->sw_valid && !pml4_is_dirty(pml4, page->va))
+	{
+		page->is_loaded = false;
+		return true;
+	}
+	anon_forget_slot(page);
+
+	// 먼저 압축해서 메모리에 두고, 압축이 안 되거나 자리가 없을 때만 디스크에 쓴다.
+	// 프레임과의 연결은 vm_evict_frame에서 끊는다.
+	if (!zswap_store(page, page->frame->kva) && !anon_swap_to_disk(page, page->frame->kva))
+	{
+		// 스왑 공간이 가득 찼다. 매핑을 되돌려 놓고 실패를 알리면 호출자가 OOM killer를 부른다.
+		// 슬롯이 없으므로 dirty 비트가 없어도 다음 스왑아웃 때 다시 쓴다.
+		pml4_set_page(pml4, page->va, page->frame->kva, page->writable);
+		pml4_set_accessed(pml4, page->va, true);
+		return false;
+	}
+
+	page->is_loaded = false;
 	return true;
 }
 
@@ -114,4 +289,8 @@ static void
 anon_destroy(struct page *page)
 {
 	struct anon_page *anon_page = &page->anon;
+
+	// 페이지의 압축 항목이나 디스크 슬롯을 돌려준다. 적재된 페이지도 슬롯을 가지고 있을 수 있다.
+	zswap_free(page);
+	anon_forget_slot(page);
 }
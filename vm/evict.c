@@ -0,0 +1,440 @@
+/* evict.c: 페이지 교체 정책들. 커널 커맨드라인 옵션 "-evict=NAME"으로 고른다.
+ *
+ * clock: 전역 second chance. 깨끗한 프레임을 먼저 고른다. (기본값)
+ * lru:   8비트 aging 카운터로 근사한 LRU.
+ * car:   CAR(Clock with Adaptive Replacement). ARC처럼 한 번 쓰인 프레임과 여러 번 쓰인
+ *        프레임을 두 clock으로 나누고, 최근에 쫓겨난 페이지의 기록으로 두 쪽의 크기를 맞춘다. */
+
+#include "vm/evict.h"
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include <debug.h>
+#include "vm/vm.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+static size_t frame_cnt; // frame table의 프레임 수
+
+static void
+evict_nop_add(struct frame *frame UNUSED)
+{
+}
+
+static void
+evict_nop_remove(struct frame *frame UNUSED, struct page *evicted UNUSED)
+{
+}
+
+static void
+evict_nop_access(struct frame *frame UNUSED, struct page *page UNUSED)
+{
+}
+
+/* ---------------------------------------------------------------- clock */
+
+// 깨끗한 희생자를 찾는 동안 건너뛸 수 있는 더러운 후보 수
+#define EVICT_DIRTY_SKIP 32
+
+static size_t clock_hand; // 시계 바늘, 호출 사이에 유지됨
+
+static void
+clock_init(size_t cnt)
+{
+	frame_cnt = cnt;
+	clock_hand = 0;
+}
+
+// 소유자의 pml4에서 accessed 비트를 확인한다. 쓰기 없이 버릴 수 있는 깨끗한 프레임을
+// 먼저 고르고, 더러운 후보를 EVICT_DIRTY_SKIP개 지나도록 없으면 처음 만난 더러운 후보를 고른다.
+static struct frame *
+clock_victim(void)
+{
+	struct frame *victim = NULL;
+	size_t dirty_cnt = 0;
+
+	// 모든 프레임이 쫓아낼 수 없는 상태면 두 바퀴 돌고 포기
+	for (size_t i = 0; i < frame_cnt * 2; i++)
+	{
+		struct frame *frame = vm_frame_at(clock_hand);
+		clock_hand = (clock_hand + 1) % frame_cnt;
+
+		if (!frame_evictable(frame) || frame_test_and_clear_accessed(frame))
+		{
+			continue;
+		}
+		if (frame_is_clean(frame))
+		{
+			return frame;
+		}
+		if (victim == NULL)
+		{
+			victim = frame;
+		}
+		if (++dirty_cnt >= EVICT_DIRTY_SKIP)
+		{
+			break;
+		}
+	}
+	return victim;
+}
+
+static const struct evict_policy clock_policy = {
+	.name = "clock",
+	.init = clock_init,
+	.victim = clock_victim,
+	.add = evict_nop_add,
+	.remove = evict_nop_remove,
+	.access = evict_nop_access,
+};
+
+/* ------------------------------------------------------------------ lru */
+
+// 희생자를 찾을 때마다 aging할 후보 수
+#define LRU_SCAN 64
+#define LRU_REFERENCED 0x80
+
+static size_t lru_hand;
+
+static void
+lru_init(size_t cnt)
+{
+	frame_cnt = cnt;
+	lru_hand = 0;
+}
+
+// 새로 채운 프레임은 방금 쓰인 것으로 본다.
+static void
+lru_add(struct frame *frame)
+{
+	frame->age = LRU_REFERENCED;
+}
+
+static void
+lru_access(struct frame *frame, struct page *page UNUSED)
+{
+	frame->age |= LRU_REFERENCED;
+}
+
+// 바늘 앞의 후보 LRU_SCAN개를 aging한다: age를 오른쪽으로 한 칸 밀고, 그동안 accessed 비트가
+// 켜졌으면 맨 위 비트를 켠다. 그중 age가 가장 작은 (가장 오래 안 쓰인) 프레임을 고르고,
+// 같으면 쓰기 없이 버릴 수 있는 깨끗한 프레임을 고른다.
+static struct frame *
+lru_victim(void)
+{
+	struct frame *victim = NULL;
+	bool victim_clean = false;
+	size_t scanned = 0;
+
+	for (size_t i = 0; i < frame_cnt && scanned < LRU_SCAN; i++)
+	{
+		struct frame *frame = vm_frame_at(lru_hand);
+		lru_hand = (lru_hand + 1) % frame_cnt;
+		if (!frame_evictable(frame))
+		{
+			continue;
+		}
+		scanned++;
+
+		frame->age >>= 1;
+		if (frame_test_and_clear_accessed(frame))
+		{
+			frame->age |= LRU_REFERENCED;
+		}
+		if (victim == NULL || frame->age < victim->age)
+		{
+			victim = frame;
+			victim_clean = frame_is_clean(frame);
+		}
+		else if (frame->age == victim->age && !victim_clean && frame_is_clean(frame))
+		{
+			victim = frame;
+			victim_clean = true;
+		}
+	}
+	return victim;
+}
+
+static const struct evict_policy lru_policy = {
+	.name = "lru",
+	.init = lru_init,
+	.victim = lru_victim,
+	.add = lru_add,
+	.remove = evict_nop_remove,
+	.access = lru_access,
+};
+
+/* ------------------------------------------------------------------ car */
+
+// frame->evict_list, car_ghost.list 값
+enum car_list
+{
+	CAR_NONE,
+	CAR_T1, // 올라온 뒤 한 번만 쓰인 프레임 (recency)
+	CAR_T2, // 두 번 이상 쓰인 프레임 (frequency)
+	CAR_B1, // T1에서 쫓겨난 페이지의 기록
+	CAR_B2, // T2에서 쫓겨난 페이지의 기록
+};
+
+// 쫓겨난 페이지의 기록. 내용은 없고 (프로세스, 가상 주소)만 기억한다.
+struct car_ghost
+{
+	struct hash_elem elem; // car.ghosts element
+	struct list_elem lru;  // car.b1/b2 element, 앞쪽이 오래된 기록
+	uint64_t key;
+	enum car_list list;
+};
+
+static struct
+{
+	struct list t1, t2;		 // 앞쪽이 clock 바늘 자리
+	struct list b1, b2;		 // 앞쪽이 가장 오래된 기록
+	size_t t1_cnt, t2_cnt;
+	size_t b1_cnt, b2_cnt;
+	size_t p;				 // T1의 목표 크기
+	struct hash ghosts;		 // key로 찾는 기록들
+	struct car_ghost *pool;	 // 기록 2 * frame_cnt개
+	struct list free_ghosts; // 쓰지 않는 기록
+} car;
+
+static uint64_t
+car_key(struct page *page)
+{
+	return ((uint64_t)page->thread->tid << 36) ^ ((uint64_t)page->va >> PGBITS);
+}
+
+static uint64_t
+car_ghost_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_bytes(&hash_entry(e, struct car_ghost, elem)->key, sizeof(uint64_t));
+}
+
+static bool
+car_ghost_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+	return hash_entry(a, struct car_ghost, elem)->key < hash_entry(b, struct car_ghost, elem)->key;
+}
+
+static void
+car_init(size_t cnt)
+{
+	frame_cnt = cnt;
+	list_init(&car.t1);
+	list_init(&car.t2);
+	list_init(&car.b1);
+	list_init(&car.b2);
+	list_init(&car.free_ghosts);
+	car.t1_cnt = car.t2_cnt = car.b1_cnt = car.b2_cnt = 0;
+	car.p = 0;
+	car.pool = calloc(2 * cnt, sizeof(struct car_ghost));
+	if (car.pool == NULL || !hash_init(&car.ghosts, car_ghost_hash, car_ghost_less, NULL))
+	{
+		PANIC("car 교체 정책 초기화 실패");
+	}
+	for (size_t i = 0; i < 2 * cnt; i++)
+	{
+		list_push_back(&car.free_ghosts, &car.pool[i].lru);
+	}
+}
+
+// 기록 하나를 지운다.
+static void
+car_ghost_drop(struct car_ghost *g)
+{
+	hash_delete(&car.ghosts, &g->elem);
+	list_remove(&g->lru);
+	if (g->list == CAR_B1)
+	{
+		car.b1_cnt--;
+	}
+	else
+	{
+		car.b2_cnt--;
+	}
+	list_push_back(&car.free_ghosts, &g->lru);
+}
+
+// 쫓겨난 페이지를 B1 또는 B2의 최신 기록으로 남긴다. 기록은 |T1| + |B1| <= c,
+// 전체 <= 2c가 되도록 오래된 것부터 버린다.
+static void
+car_ghost_add(struct page *page, enum car_list list)
+{
+	struct car_ghost probe;
+	probe.key = car_key(page);
+	struct hash_elem *e = hash_find(&car.ghosts, &probe.elem);
+	if (e != NULL)
+	{
+		car_ghost_drop(hash_entry(e, struct car_ghost, elem));
+	}
+
+	if (list == CAR_B1 && car.b1_cnt > 0 && car.t1_cnt + car.b1_cnt >= frame_cnt)
+	{
+		car_ghost_drop(list_entry(list_front(&car.b1), struct car_ghost, lru));
+	}
+	while (list_empty(&car.free_ghosts) ||
+		   car.t1_cnt + car.t2_cnt + car.b1_cnt + car.b2_cnt >= 2 * frame_cnt)
+	{
+		struct list *victims = car.b2_cnt > 0 ? &car.b2 : &car.b1;
+		if (list_empty(victims))
+		{
+			return;
+		}
+		car_ghost_drop(list_entry(list_front(victims), struct car_ghost, lru));
+	}
+
+	struct car_ghost *g = list_entry(list_pop_front(&car.free_ghosts), struct car_ghost, lru);
+	g->key = probe.key;
+	g->list = list;
+	hash_insert(&car.ghosts, &g->elem);
+	if (list == CAR_B1)
+	{
+		list_push_back(&car.b1, &g->lru);
+		car.b1_cnt++;
+	}
+	else
+	{
+		list_push_back(&car.b2, &g->lru);
+		car.b2_cnt++;
+	}
+}
+
+// FRAME을 LIST의 뒤(바늘에서 가장 먼 자리)로 옮긴다.
+static void
+car_move(struct frame *frame, enum car_list list)
+{
+	if (frame->evict_list == CAR_T1)
+	{
+		car.t1_cnt--;
+	}
+	else if (frame->evict_list == CAR_T2)
+	{
+		car.t2_cnt--;
+	}
+	if (frame->evict_list != CAR_NONE)
+	{
+		list_remove(&frame->evict_elem);
+	}
+
+	frame->evict_list = list;
+	if (list == CAR_T1)
+	{
+		list_push_back(&car.t1, &frame->evict_elem);
+		car.t1_cnt++;
+	}
+	else if (list == CAR_T2)
+	{
+		list_push_back(&car.t2, &frame->evict_elem);
+		car.t2_cnt++;
+	}
+}
+
+static void
+car_add(struct frame *frame)
+{
+	car_move(frame, CAR_T1);
+}
+
+static void
+car_remove(struct frame *frame, struct page *evicted)
+{
+	enum car_list from = frame->evict_list;
+	car_move(frame, CAR_NONE);
+	if (evicted != NULL && from != CAR_NONE)
+	{
+		car_ghost_add(evicted, from == CAR_T1 ? CAR_B1 : CAR_B2);
+	}
+}
+
+// 폴트가 난 페이지가 최근에 쫓겨난 기록에 있으면 그쪽 리스트가 너무 작았던 것이다.
+// B1이면 T1의 목표 크기를 늘리고, B2면 줄인다. 다시 쓰인 페이지는 T2로 간다.
+static void
+car_access(struct frame *frame, struct page *page)
+{
+	struct car_ghost probe;
+	probe.key = car_key(page);
+	struct hash_elem *e = hash_find(&car.ghosts, &probe.elem);
+	if (e == NULL)
+	{
+		return;
+	}
+
+	struct car_ghost *g = hash_entry(e, struct car_ghost, elem);
+	if (g->list == CAR_B1)
+	{
+		size_t delta = car.b2_cnt > car.b1_cnt ? car.b2_cnt / car.b1_cnt : 1;
+		car.p = car.p + delta < frame_cnt ? car.p + delta : frame_cnt;
+	}
+	else
+	{
+		size_t delta = car.b1_cnt > car.b2_cnt ? car.b1_cnt / car.b2_cnt : 1;
+		car.p = car.p > delta ? car.p - delta : 0;
+	}
+	car_ghost_drop(g);
+	if (frame->evict_list != CAR_NONE)
+	{
+		car_move(frame, CAR_T2);
+	}
+}
+
+// T1이 목표 크기 이상이면 T1의 바늘에서, 아니면 T2의 바늘에서 고른다.
+// 참조된 프레임은 참조 비트를 지우고 T2의 뒤로 보낸다. 고른 프레임은 쫓아내지 못할 때를
+// 대비해 제 리스트의 뒤로 옮겨 두고, 실제로 쫓겨나면 car_remove가 뺀다.
+static struct frame *
+car_victim(void)
+{
+	size_t limit = 2 * (car.t1_cnt + car.t2_cnt) + 2;
+	for (size_t i = 0; i < limit; i++)
+	{
+		bool from_t1 = !list_empty(&car.t1) && (car.t1_cnt >= (car.p > 0 ? car.p : 1) || list_empty(&car.t2));
+		struct list *clock = from_t1 ? &car.t1 : &car.t2;
+		if (list_empty(clock))
+		{
+			return NULL;
+		}
+
+		struct frame *frame = list_entry(list_front(clock), struct frame, evict_elem);
+		if (!frame_evictable(frame))
+		{
+			car_move(frame, frame->evict_list);
+			continue;
+		}
+		if (frame_test_and_clear_accessed(frame))
+		{
+			car_move(frame, CAR_T2);
+			continue;
+		}
+		car_move(frame, frame->evict_list);
+		return frame;
+	}
+	return NULL;
+}
+
+static const struct evict_policy car_policy = {
+	.name = "car",
+	.init = car_init,
+	.victim = car_victim,
+	.add = car_add,
+	.remove = car_remove,
+	.access = car_access,
+};
+
+/* ---------------------------------------------------------------------- */
+
+static const struct evict_policy *const evict_policies[] = {&clock_policy, &lru_policy, &car_policy};
+
+const struct evict_policy *evict_policy = &clock_policy;
+
+// NAME인 정책을 고른다. vm_init보다 먼저 불러야 한다. 없는 이름이면 false.
+bool evict_policy_select(const char *name)
+{
+	for (size_t i = 0; i < sizeof evict_policies / sizeof *evict_policies; i++)
+	{
+		if (!strcmp(evict_policies[i]->name, name))
+		{
+			evict_policy = evict_policies[i];
+			return true;
+		}
+	}
+	return false;
+}
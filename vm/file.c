@@ -30,7 +30,7 @@ bool file_backed_initializer(struct page *page, enum vm_type type, void *kva)
 	/* Set up the handler */
 	page->operations = &file_ops;
 
-	lazy_load_info *aux = malloc(sizeof(lazy_load_info));
+	lazy_load_info *aux = vm_load_info_alloc();
 	memcpy(aux, page->uninit.aux, sizeof(lazy_load_info));
 
 	struct file_page *file_page = &page->file;
@@ -105,7 +105,12 @@ file_backed_swap_out(struct page *page)
 	// printf("file swap out 되나?\n");
 
 	// 페이지가 dirty (true)하면 = 쓰기를 했으면
-	if (pml4_is_dirty(thread_current()->pml4, page->va))
+	// 현재 스레드가 아닌 프레임 소유자의 pml4를 확인해야 한다.
+	uint64_t *pml4 = page->frame->pml4;
+	// 쓰는 도중 소유자가 페이지를 고치지 못하도록 먼저 매핑을 끊는다. (kswapd)
+	// dirty 비트는 present 비트를 지워도 남아있다.
+	pml4_clear_page(pml4, page->va);
+	if (pml4_is_dirty(pml4, page->va))
 	{
 		// printf("file swap out 되나?\n");
 		lazy_load_info *aux = page->file.aux;
@@ -117,20 +122,19 @@ file_backed_swap_out(struct page *page)
 			lock_acquire(&filesys_lock);
 			flag = true;
 		}
-		file_write_at(aux->file, page->va, aux->read_bytes, aux->offset);
+		// 소유자의 주소 공간이 아닐 수 있으므로 커널 주소로 쓴다.
+		file_write_at(aux->file, page->frame->kva, aux->read_bytes, aux->offset);
 		if (flag)
 		{
 			flag = false;
 			lock_release(&filesys_lock);
 		}
 		// 페이지 교체후 페이지의 더티 비트 끄기
-		pml4_set_dirty(thread_current()->pml4, page->va, false);
+		pml4_set_dirty(pml4, page->va, false);
 	}
 
 	// printf("file swap out 되나?\n");
-	list_remove(&page->frame_elem);
 	page->is_loaded = false;
-	pml4_clear_page(thread_current()->pml4, page->va);
 	return true;
 }
 
@@ -146,7 +150,7 @@ file_backed_destroy(struct page *page)
 	{
 
 		// 페이지가 dirty (true)하면 = 쓰기를 했으면
-		if (pml4_is_dirty(thread_current()->pml4, page->start_address))
+		if (pml4_is_dirty(thread_current()->pml4, page->va))
 		{
 			lazy_load_info *aux = page->file.aux;
 
@@ -157,7 +161,7 @@ file_backed_destroy(struct page *page)
 				lock_acquire(&filesys_lock);
 				flag = true;
 			}
-			file_write_at(aux->file, page->start_address, aux->read_bytes, aux->offset);
+			file_write_at(aux->file, page->va, aux->read_bytes, aux->offset);
 			if (flag)
 			{
 				flag = false;
@@ -166,7 +170,7 @@ file_backed_destroy(struct page *page)
 		}
 	}
 
-	free(file_page->aux);
+	vm_load_info_free(file_page->aux);
 }
 
 // 파일을 읽어서 메모리에 콘텐츠를 적재하는 함수
@@ -227,101 +231,50 @@ lazy_load_contents(struct page *page, void *aux)
 }
 
 /* Do the mmap */
+// 매핑 범위를 영역 하나로 등록만 한다. 페이지는 처음 접근할 때 만들어지므로
+// 매핑 크기와 상관없이 영역 수에 대해 O(log n)이다.
 void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset)
 {
+	// 파일은 다시 열기만 하므로 vm_lock으로 충분하다. (fork 중인 자식이 영역을 읽는다)
+	int held = vm_lock_acquire(false);
 
-	void *check_addr = addr;
-
-	bool flag = false;
-	// merger test lock
-	if (!lock_held_by_current_thread(&filesys_lock))
-	{
-		lock_acquire(&filesys_lock);
-		flag = true;
-	}
+	void *ret = NULL;
+	// 매핑된 파일 살리기 위해 다시 연다. 영역이 없어질 때 닫힌다.
 	file = file_reopen(file);
-	if (flag)
-	{
-		flag = false;
-		lock_release(&filesys_lock);
-	}
-
-	// 페이지 채우기
-	while (length > 0)
+	if (file != NULL)
 	{
-		size_t page_read_bytes = length < PGSIZE ? length : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		lazy_load_info *aux_info = malloc(sizeof(struct lazy_load_info_t));
-
-		aux_info->file = file; // 매핑된 파일 살리기 위해 구조체 재설정해줌.
-		aux_info->offset = offset;
-		aux_info->read_bytes = page_read_bytes;
-		aux_info->zero_bytes = page_zero_bytes;
-		aux_info->start_addr = check_addr;
-
-		aux = aux_info;
-		if (!vm_alloc_page_with_initializer(VM_FILE, check_addr, writable, lazy_load_contents, aux))
+		if (vma_map(&thread_current()->spt, addr, length, VM_FILE, writable, lazy_load_contents,
+					file, offset, length))
 		{
-			// printf("do_mmap check\n");
-			return NULL;
+			ret = addr;
+		}
+		else
+		{
+			file_close(file);
 		}
-
-		// 다음 페이지로 이동
-		offset += page_read_bytes;
-		length -= page_read_bytes;
-		check_addr += PGSIZE;
 	}
+
+	vm_lock_release(held);
 	// printf("do_mmap check2\n");
-	return addr;
+	return ret;
 }
 
 /* Do the munmap */
+// ADDR에서 시작하는 mmap 영역을 없앤다. 만들어진 페이지만 write back 하고 지운다.
 void do_munmap(void *addr)
 {
-	struct page *page = NULL;
+	struct supplemental_page_table *spt = &thread_current()->spt;
 
-	void *check_addr = addr;
-	page = spt_find_page(&thread_current()->spt, addr);
+	// 프레임을 놓는 동안 kswapd가 같은 프레임을 쫓아내지 못하도록 잠근다.
+	// 더러운 페이지를 파일에 쓰므로 filesys_lock도 잡는다.
+	int held = vm_lock_acquire(true);
 
-	// page != null
-	while (page = spt_find_page(&thread_current()->spt, check_addr))
+	// 파일 매핑과 mmap으로 만든 익명 영역만 없앨 수 있다.
+	struct vm_area *vma = vma_find(spt, addr);
+	if (vma != NULL && vma->start == addr && (VM_TYPE(vma->type) == VM_FILE || (vma->type & VM_MMAP)))
 	{
-		// 파일의 전체 페이지인지 순회하면서 체크
-		if (page->start_address == addr)
-		{
-			page->start_address = NULL;
-			// 페이지 쓰기 여부 확인후 파일에 다시 쓰기
-			if (page->frame != NULL)
-			{
-				// 페이지가 dirty (true)하면 = 쓰기를 했으면
-				if (pml4_is_dirty(thread_current()->pml4, check_addr))
-				{
-					lazy_load_info *aux = page->file.aux;
-
-					bool flag = false;
-					// merger test lock
-					if (!lock_held_by_current_thread(&filesys_lock))
-					{
-						lock_acquire(&filesys_lock);
-						flag = true;
-					}
-					file_write_at(aux->file, check_addr, aux->read_bytes, aux->offset);
-
-					if (flag)
-					{
-						flag = false;
-						lock_release(&filesys_lock);
-					}
-				}
-			}
-
-			// spt에서 프레임 반환 및 페이지 삭제
-			spt_remove_page(&thread_current()->spt, page);
-		}
-
-		check_addr += PGSIZE;
+		vma_unmap(spt, vma);
 	}
+
+	vm_lock_release(held);
 }
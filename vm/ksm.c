@@ -0,0 +1,209 @@
+/* ksm.c: 같은 내용의 익명 페이지 합치기 (kernel samepage merging). */
+
+#include "vm/ksm.h"
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+#include "vm/vm.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "userprog/process.h"
+
+#define KSM_BATCH 64	   // 한 번 깨어날 때 살펴볼 프레임 수
+#define KSM_SLEEP_TICKS 10 // 배치 사이에 쉬는 tick 수
+
+/* 프레임마다 하나씩, 같은 번호 자리에 있다. 내용의 해시를 기억해 두었다가 다음 바퀴에서도
+ * 같으면 (자주 바뀌지 않는 프레임이면) 이번 바퀴의 해시 테이블에 후보로 넣는다. */
+struct ksm_node
+{
+	struct hash_elem elem; // ksm.table element
+	uint64_t sum;		   // 지난번에 본 내용의 해시
+	bool valid;			   // sum이 이 프레임의 것인지
+};
+
+// ksmd 상태. 프레임처럼 vm_lock 아래에서만 바뀐다.
+static struct
+{
+	struct ksm_node *nodes; // frame table과 같은 순서
+	size_t size;			// 프레임 수
+	size_t hand;			// 다음에 볼 프레임 번호
+	struct hash table;		// 이번 바퀴의 후보들, 해시가 같으면 한 자리
+	uint64_t zero_sum;		// 0으로 찬 페이지의 해시
+} ksm;
+
+struct ksm_stats ksm_stats;
+
+static void ksmd(void *aux);
+
+static uint64_t
+ksm_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_entry(e, struct ksm_node, elem)->sum;
+}
+
+static bool
+ksm_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+	return hash_entry(a, struct ksm_node, elem)->sum < hash_entry(b, struct ksm_node, elem)->sum;
+}
+
+void ksm_init(void)
+{
+	ksm.size = vm_frame_cnt();
+	ksm.nodes = calloc(ksm.size, sizeof(struct ksm_node));
+	if (ksm.nodes == NULL || !hash_init(&ksm.table, ksm_hash, ksm_less, NULL))
+	{
+		PANIC("ksmd 초기화 실패");
+	}
+	ksm.hand = 0;
+	ksm.zero_sum = hash_bytes(vm_zero_frame()->kva, PGSIZE);
+	if (thread_create("ksmd", PRI_MIN, ksmd, NULL) == TID_ERROR)
+	{
+		PANIC("ksmd 생성 실패");
+	}
+}
+
+void ksm_print_stats(void)
+{
+	printf("KSM: %llu pages scanned, %llu merged, %llu unmerged\n",
+		   (unsigned long long)ksm_stats.scanned, (unsigned long long)ksm_stats.merged,
+		   (unsigned long long)ksm_stats.unmerged);
+}
+
+// 합칠 수 있는 프레임: 스왑으로만 내보내는 평범한 익명 프레임이고, 매핑이 모두 살아 있으며 huge page가 아님
+static bool
+ksm_frame_ok(struct frame *frame)
+{
+	struct page *page = frame->page;
+	if (page == NULL || !page->is_loaded || frame->pin_cnt != 0 || frame->inode != NULL || frame->shm != NULL ||
+		VM_TYPE(page->operations->type) != VM_ANON)
+	{
+		return false;
+	}
+	struct list_elem *e;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *p = list_entry(e, struct page, frame_elem);
+		if (p->thread->pml4 == NULL || pml4_is_huge(p->thread->pml4, p->va))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// FRAME의 매핑을 모두 읽기 전용으로 바꾼다. dirty 비트는 그대로 둔다.
+// ksmd는 유저 주소 공간 밖에서 돌기 때문에 TLB에 남은 항목은 없다.
+static void
+ksm_write_protect(struct frame *frame)
+{
+	struct list_elem *e;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+		uint64_t *pte = pml4e_walk(page->thread->pml4, (uint64_t)page->va, 0);
+		if (pte != NULL)
+		{
+			*pte &= ~(uint64_t)PTE_W;
+		}
+	}
+}
+
+/* FRAME의 페이지를 TARGET으로 옮긴다. 비교하는 동안 내용이 바뀌지 않도록 먼저 둘 다
+ * 쓰기 금지로 바꾼다. 그 사이의 쓰기는 폴트가 나서 vm_lock을 기다리고, 합치지 못했으면
+ * vm_handle_wp가 쓰기 권한만 되돌린다. 내용이 다르면 false. */
+static bool
+ksm_merge(struct frame *frame, struct frame *target)
+{
+	struct frame *zero = vm_zero_frame();
+	ksm_write_protect(frame);
+	if (target != zero)
+	{
+		ksm_write_protect(target);
+	}
+	if (memcmp(frame->kva, target->kva, PGSIZE) != 0)
+	{
+		return false;
+	}
+
+	if (target != zero)
+	{
+		struct list_elem *e;
+		for (e = list_begin(&target->pages); e != list_end(&target->pages); e = list_next(e))
+		{
+			list_entry(e, struct page, frame_elem)->ksm = true;
+		}
+	}
+	struct page *page = frame->page;
+	vm_frame_merge(target, page);
+	page->ksm = true;
+	ksm_stats.merged++;
+	return true;
+}
+
+// IDX번 프레임을 살펴보고, 이번 바퀴에 같은 내용의 후보가 있으면 합친다.
+static void
+ksm_scan_frame(size_t idx)
+{
+	struct frame *frame = vm_frame_at(idx);
+	struct ksm_node *node = &ksm.nodes[idx];
+
+	// 이미 공유 중인 프레임은 합칠 대상은 될 수 있어도 옮길 필요는 없다.
+	if (frame->cnt != 1 || !ksm_frame_ok(frame))
+	{
+		node->valid = false;
+		return;
+	}
+	ksm_stats.scanned++;
+
+	// 지난 바퀴 뒤로 내용이 바뀐 프레임은 곧 또 쓰일 것이므로 이번에는 기억만 해 둔다.
+	uint64_t sum = hash_bytes(frame->kva, PGSIZE);
+	if (!node->valid || node->sum != sum)
+	{
+		node->sum = sum;
+		node->valid = true;
+		return;
+	}
+
+	if (sum == ksm.zero_sum && ksm_merge(frame, vm_zero_frame()))
+	{
+		return;
+	}
+	struct hash_elem *e = hash_insert(&ksm.table, &node->elem);
+	if (e == NULL)
+	{
+		return;
+	}
+	// 먼저 들어온 후보가 없어졌거나 내용이 달라졌으면 이 프레임이 대신 후보가 된다.
+	struct frame *target = vm_frame_at(hash_entry(e, struct ksm_node, elem) - ksm.nodes);
+	if (!ksm_frame_ok(target) || !ksm_merge(frame, target))
+	{
+		hash_replace(&ksm.table, &node->elem);
+	}
+}
+
+// 우선순위가 가장 낮은 스레드로 돌면서 KSM_SLEEP_TICKS마다 프레임 KSM_BATCH개씩 훑는다.
+static void
+ksmd(void *aux UNUSED)
+{
+	for (;;)
+	{
+		timer_sleep(KSM_SLEEP_TICKS);
+
+		lock_acquire(&vm_lock);
+		for (size_t i = 0; i < KSM_BATCH; i++)
+		{
+			// 새 바퀴: 지난 바퀴의 후보는 이미 바뀌었을 수 있으므로 잊는다.
+			if (ksm.hand == 0)
+			{
+				hash_clear(&ksm.table, NULL);
+			}
+			ksm_scan_frame(ksm.hand);
+			ksm.hand = (ksm.hand + 1) % ksm.size;
+		}
+		lock_release(&vm_lock);
+	}
+}
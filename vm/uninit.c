@@ -73,5 +73,5 @@ uninit_destroy(struct page *page)
 	// lazy_load_info *aux_info = uninit->aux;
 	// struct file *file = aux_info->file;
 	// file_close(aux_info->file);
-	free(uninit->aux);
+	vm_load_info_free(uninit->aux);
 }
@@ -1,6 +1,7 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "include/lib/kernel/hash.h"
@@ -9,12 +10,72 @@
 #include "vm/uninit.h"
 #include "include/userprog/process.h"
 #include <string.h>
+#include <stdio.h>
 #include "vm/anon.h"
+#include "threads/synch.h"
+#include "threads/interrupt.h"
+#include "lib/kernel/bitmap.h"
+#include "filesys/file.h"
+#include "filesys/page_cache.h"
+#include "intrinsic.h"
+
+// frame table : user pool 페이지 번호로 인덱싱되는 프레임 배열
+struct frame_table
+{
+	struct frame *frames; // user pool의 모든 물리 페이지에 대한 프레임
+	size_t size;		  // 프레임 개수 (= user pool 페이지 수)
+	size_t free_cnt;	  // user pool에 남은 빈 프레임 수
+};
+static struct frame_table frame_table;
+
+/* 폴트 경로에서 자주 만들고 지우는 객체는 타입별 slab cache에서 받는다. */
+static struct slab_cache page_slab; // struct page
+static struct slab_cache aux_slab;	// lazy_load_info
+
+static void frame_table_init(void);
+
+/* 한 번도 쓰지 않은 익명 페이지(스택, BSS)의 읽기 폴트는 모두 이 프레임을
+ * 읽기 전용으로 매핑한다. frame table에 속하지 않으므로 쫓겨나거나 해제되지 않는다. */
+static struct frame zero_frame;
+
+/* kswapd: 빈 프레임이 low watermark 아래로 내려가면 깨어나서
+ * high watermark까지 미리 쫓아낸다. 폴트 경로는 대부분 빈 프레임을 바로 얻는다. */
+size_t kswapd_low_wmark;
+size_t kswapd_high_wmark;
+static struct semaphore kswapd_sema;
+static bool kswapd_awake;
+
+static void kswapd_init(void);
+static void kswapd(void *aux);
+static void kswapd_wakeup(void);
+
+size_t fault_around_max = FAULT_AROUND_DEFAULT;
+
+bool vm_huge_pages = true;
+
+bool vm_ksm = false;
+
+struct vm_stats vm_stats;
+
+/* 폴트 경로의 락. 익명 폴트, 스택 성장, 스왑 인은 vm_lock만 잡으므로 다른 프로세스가
+ * filesys_lock을 잡고 파일을 읽는 동안에도 진행된다. 파일 내용을 읽거나 써야 하는 쪽
+ * (파일 페이지 폴트, munmap, 프로세스 종료)만 filesys_lock을 먼저 잡는다.
+ * vm_lock만 잡은 스레드는 filesys_lock을 기다리면 안 되므로, 쫓아낼 때도 파일에 써야 하는
+ * 프레임은 고르지 않는다. (frame_evictable) */
+struct lock vm_lock;
+
+// 스왑 공간이 가득 차서 스왑에 쓰지 않고 비울 수 있는 프레임만 고르는 중 (vm_lock으로 보호)
+static bool evict_swap_full;
+
+// vm_lock_acquire가 새로 잡은 락
+#define VM_HELD_FS 1
+#define VM_HELD_VM 2
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void vm_init(void)
 {
+	lock_init(&vm_lock);
 	vm_anon_init();
 	vm_file_init();
 #ifdef EFILESYS /* For project 4 */
@@ -23,7 +84,62 @@ void vm_init(void)
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table);
+	slab_cache_init(&page_slab, "page", sizeof(struct page), NULL);
+	slab_cache_init(&aux_slab, "lazy_load_info", sizeof(lazy_load_info), NULL);
+	vma_init();
+	frame_table_init();
+	evict_policy->init(frame_table.size);
+	zero_frame.kva = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	list_init(&zero_frame.pages);
+	page_cache_init();
+	kswapd_init();
+	// 커널이 유저 버퍼에 쓸 때도 읽기 전용 매핑을 지키게 해서, 공유 중인 프레임(COW, zero page,
+	// ksmd가 합친 프레임)에는 폴트를 거쳐 복사본에 쓰도록 한다.
+	lcr0(rcr0() | CR0_WP);
+	if (vm_ksm)
+	{
+		ksm_init();
+	}
+}
+
+// 교체 정책과 스왑 횟수를 출력한다.
+void vm_print_stats(void)
+{
+	printf("VM: %s replacement, %llu frames evicted, %llu pages swapped out, %llu swapped in\n",
+		   evict_policy->name, (unsigned long long)vm_stats.evict_cnt,
+		   (unsigned long long)vm_stats.swap_out_cnt, (unsigned long long)vm_stats.swap_in_cnt);
+}
+
+/* vm_lock을 잡는다. FILE이면 파일을 읽고 쓸 수 있도록 filesys_lock을 먼저 잡는다.
+ * 이미 잡고 있는 락은 건드리지 않고, 새로 잡은 락을 vm_lock_release에 넘길 값으로 돌려준다. */
+int vm_lock_acquire(bool file)
+{
+	int held = 0;
+	// vm_lock을 잡은 채로 filesys_lock을 기다리면 순서가 뒤집혀 교착될 수 있다.
+	ASSERT(!file || lock_held_by_current_thread(&filesys_lock) || !lock_held_by_current_thread(&vm_lock));
+	if (file && !lock_held_by_current_thread(&filesys_lock))
+	{
+		lock_acquire(&filesys_lock);
+		held |= VM_HELD_FS;
+	}
+	if (!lock_held_by_current_thread(&vm_lock))
+	{
+		lock_acquire(&vm_lock);
+		held |= VM_HELD_VM;
+	}
+	return held;
+}
+
+void vm_lock_release(int held)
+{
+	if (held & VM_HELD_VM)
+	{
+		lock_release(&vm_lock);
+	}
+	if (held & VM_HELD_FS)
+	{
+		lock_release(&filesys_lock);
+	}
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -45,7 +161,25 @@ page_get_type(struct page *page)
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
+static bool vm_resolve_fault(struct supplemental_page_table *spt, struct page *page, bool write, bool not_present);
+static bool vm_map_zero_page(struct page *page);
+static bool vm_claim_cached_page(struct page *page);
+static bool vm_claim_shared_page(struct page *page);
+static bool vm_evict_shared(struct frame *frame);
+static bool vm_evict_cow(struct frame *frame);
+static void vm_try_promote(struct supplemental_page_table *spt, struct page *page);
+static bool vm_promotable(struct page *page, bool writable);
+static bool frame_is_dirty(struct frame *frame);
+static bool frame_has_file(struct frame *frame);
+static bool frame_unmap_clean(struct frame *frame);
+static bool vm_claim_fault_around(struct supplemental_page_table *spt, struct page *page);
+static void vm_swap_readahead(struct supplemental_page_table *spt, struct page *page, size_t idx);
 static struct frame *vm_evict_frame(void);
+static bool vm_oom_kill(void);
+static void vm_release_frame(struct page *page);
+static void frame_attach(struct frame *frame, struct page *page);
+static void frame_detach(struct frame *frame, struct page *page);
+static void frame_free(struct frame *frame);
 
 /*-------------------------- project3 vm 추가 필드------------------------------------*/
 static struct page *page_entry_from_hash_elem(struct hash_elem *supplemental_hash_elem)
@@ -78,7 +212,12 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
 		/* TODO: Insert the page into the spt. */
-		struct page *page = calloc(1, sizeof(struct page));
+		// uninit_new이 구조체 전체를 채우므로 0으로 지울 필요가 없다.
+		struct page *page = slab_alloc(&page_slab);
+		if (page == NULL)
+		{
+			goto err;
+		}
 		// page_initializer 함수 포인터 선언
 		bool (*page_initializer)(struct page *, enum vm_type, void *kva);
 
@@ -88,28 +227,28 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		case VM_ANON:
 			page_initializer = anon_initializer;
 			uninit_new(page, upage, init, type, aux, page_initializer);
-			page->start_address = NULL;
-			page->thread = thread_current();
 			break;
 
-		case VM_FILE:;
-			lazy_load_info *aux_info = aux;
+		case VM_FILE:
 			page_initializer = file_backed_initializer;
 			uninit_new(page, upage, init, type, aux, page_initializer);
-			page->start_address = aux_info->start_addr;
 			break;
 
 		default:
 			// page->thread = thread_current();
-			break;
+			slab_free(&page_slab, page);
+			goto err;
 		}
 
 		page->writable = writable;
 		page->is_loaded = false;
+		page->ksm = false;
+		page->thread = thread_current();
 		if (spt_insert_page(spt, page))
 		{
 			return true;
 		}
+		slab_free(&page_slab, page);
 	}
 
 err:
@@ -140,6 +279,53 @@ spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
 	return page;
 }
 
+// VA의 페이지를 찾고, 아직 없지만 영역 안의 주소라면 영역 정보로 페이지를 만든다.
+// 영역 밖이면 NULL.
+struct page *
+spt_get_page(struct supplemental_page_table *spt, void *va)
+{
+	struct page *page = spt_find_page(spt, va);
+	if (page != NULL)
+	{
+		return page;
+	}
+	struct vm_area *vma = vma_find(spt, va);
+	if (vma == NULL)
+	{
+		return NULL;
+	}
+
+	va = pg_round_down(va);
+	size_t ofs = va - vma->start;
+
+	// 파일 내용이 없는 페이지는 zero page로 시작하는 익명 페이지다.
+	if (vma->file == NULL || ofs >= vma->read_bytes)
+	{
+		enum vm_type type = vma->file == NULL ? vma->type : VM_ANON | VM_ZERO;
+		if (!vm_alloc_page(type, va, vma->writable))
+		{
+			return NULL;
+		}
+		return spt_find_page(spt, va);
+	}
+
+	lazy_load_info *aux = vm_load_info_alloc();
+	if (aux == NULL)
+	{
+		return NULL;
+	}
+	aux->file = vma->file;
+	aux->offset = vma->offset + ofs;
+	aux->read_bytes = vma->read_bytes - ofs < PGSIZE ? vma->read_bytes - ofs : PGSIZE;
+	aux->zero_bytes = PGSIZE - aux->read_bytes;
+	if (!vm_alloc_page_with_initializer(vma->type, va, vma->writable, vma->init, aux))
+	{
+		vm_load_info_free(aux);
+		return NULL;
+	}
+	return spt_find_page(spt, va);
+}
+
 /* Insert PAGE into spt with validation. */
 bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
 					 struct page *page UNUSED)
@@ -152,6 +338,12 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
 	if (hash_elem == NULL)
 	{
 		succ = true;
+		// 속한 영역에 매달아 munmap이 만들어진 페이지만 돌 수 있게 한다.
+		page->vma = vma_find(spt, page->va);
+		if (page->vma != NULL)
+		{
+			list_push_back(&page->vma->pages, &page->vma_elem);
+		}
 	}
 
 	return succ;
@@ -165,62 +357,70 @@ void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 
 	// 요소가 없으면 null 반환, 있으면 제거하고 hash_elem 반환
 	struct hash_elem *he = hash_delete(&spt->hash_table, &page->hash_elem);
-	if (he != NULL)
+	if (he != NULL && page->vma != NULL)
 	{
-		page = page_entry_from_hash_elem(he);
-		free(page->frame);
+		list_remove(&page->vma_elem);
 	}
 
-	vm_dealloc_page(page);
+	// write back이 유저 매핑을 쓰므로 destroy 후에 프레임을 놓는다.
+	destroy(page);
+	vm_release_frame(page);
+	slab_free(&page_slab, page);
 	// return true;
 }
 
 /* Get the struct frame, that will be evicted. */
+// 고르는 방법은 커널 옵션 "-evict"로 정한 교체 정책에 맡긴다. (vm/evict.c)
 static struct frame *
 vm_get_victim(void)
 {
-	struct frame *victim = NULL;
 	/* TODO: The policy for eviction is up to you. */
-	if (list_empty(&frame_table))
+	return evict_policy->victim();
+}
+
+// VICTIM의 내용을 스왑이나 파일로 내보내고 모든 매핑을 끊는다. 스왑 공간이 없으면 false.
+static bool
+vm_evict(struct frame *victim)
+{
+	if (victim->shm != NULL)
 	{
-		// printf("없네\n");
-		return NULL;
+		return vm_evict_shared(victim);
 	}
-	struct list_elem *page_elem = list_begin(&frame_table);
-	// printf("%p!!!!\n", page_elem);
-	struct page *page = NULL;
-	while (1)
-	{
 
-		// printf("가나라다\n");
-		if (page_elem == list_end(&frame_table))
+	// page cache 프레임은 파일에 써둔 뒤 모든 공유자의 매핑을 지운다.
+	// 캐시에 못 들어간 텍스트 프레임도 파일에서 다시 읽으면 되므로 스왑에 쓰지 않는다.
+	if (victim->inode != NULL || (victim->page->uninit.type & VM_TEXT))
+	{
+		if (victim->inode != NULL)
 		{
-			// printf("야발\n");
-			page_elem = list_begin(&frame_table);
-			// printf("%p!!!!!\n", page_elem);
+			page_cache_flush(victim);
+			page_cache_remove(victim);
 		}
-		page = list_entry(page_elem, struct page, frame_elem);
-
-		// if (page->va > USER_STACK)
-		// {
-		// 	page_elem = page_elem->next;
-		// 	if (page_elem == NULL)
-		// 		page_elem = list_begin(&frame_table);
-		// 	continue;
-		// }
-
-		if (!pml4_is_accessed(thread_current()->pml4, page->va))
+		while (!list_empty(&victim->pages))
 		{
-			victim = page->frame;
-			break;
+			struct page *page = list_entry(list_front(&victim->pages), struct page, frame_elem);
+			pml4_clear_page(page->thread->pml4, page->va);
+			frame_detach(victim, page);
+			page->frame = NULL;
 		}
+		return true;
+	}
 
-		pml4_set_accessed(thread_current()->pml4, page->va, false);
-		page_elem = list_next(page_elem);
+	if (victim->cnt > 1)
+	{
+		return vm_evict_cow(victim);
 	}
-	// printf("vm get victim %p\n!!!!!!!!\n", victim->page->va);
 
-	return victim;
+	if (!swap_out(victim->page))
+	{
+		return false;
+	}
+
+	// 쫓겨난 페이지와 프레임의 연결을 끊는다.
+	struct page *page = victim->page;
+	frame_detach(victim, page);
+	page->frame = NULL;
+	return true;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -228,26 +428,46 @@ vm_get_victim(void)
 static struct frame *
 vm_evict_frame(void)
 {
-	struct frame *victim UNUSED = vm_get_victim();
+	struct frame *victim = NULL;
+	struct page *owner = NULL;
 	/* TODO: swap out the victim and return the evicted frame. */
-	if (victim == NULL)
+	for (;;)
 	{
-		// printf("victimc이 null인가?\n"); // debug
-		return NULL;
+		victim = vm_get_victim();
+		// filesys_lock 없이 고른 파일 프레임이 그사이 더러워졌으면 다른 희생자를 고른다.
+		// 다시 고를 때는 frame_evictable이 이 프레임을 거른다.
+		while (victim != NULL && !lock_held_by_current_thread(&filesys_lock) && frame_has_file(victim) &&
+			   !frame_unmap_clean(victim))
+		{
+			victim = vm_get_victim();
+		}
+		if (victim == NULL)
+		{
+			break;
+		}
+		// 정책이 쫓겨난 페이지를 기억할 수 있도록 떼어내기 전에 소유자를 잡아 둔다.
+		owner = victim->page;
+		if (vm_evict(victim))
+		{
+			break;
+		}
+		// 스왑 공간이 가득 찼다. 스왑에 쓰지 않고 비울 수 있는 프레임(깨끗한 익명 프레임,
+		// 파일과 page cache 프레임) 중에서 다시 고르고, 그것도 없으면 OOM killer에게 맡긴다.
+		if (evict_swap_full)
+		{
+			victim = NULL;
+			break;
+		}
+		evict_swap_full = true;
 	}
-
-	// 스왑 아웃 진행, 실패시 null 반환
-	if (!swap_out(victim->page))
+	evict_swap_full = false;
+	if (victim == NULL)
 	{
-		// printf("victimc이 null인가?\n"); // debug
 		return NULL;
 	}
 
-	// if (victim->page)
-	// {
-	// 	swap_out(victim->page);
-	// }
-
+	evict_policy->remove(victim, owner);
+	vm_stats.evict_cnt++;
 	return victim;
 }
 
@@ -261,7 +481,8 @@ vm_get_frame(void)
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
 
-	void *paddr = palloc_get_page(PAL_USER | PAL_ZERO);
+	// 내용은 swap_in이 채운다. 비어 있어야 하는 페이지만 vm_do_claim_page에서 0으로 지운다.
+	void *paddr = palloc_get_page(PAL_USER);
 
 	// 메모리가 꽉찼을 경우 swap out을 처리해줘야하지만 일단 panic(todo)로 케이스만 표시하고 넘어감.
 	if (paddr == NULL)
@@ -269,49 +490,137 @@ vm_get_frame(void)
 		// printf("evict를 실행하나?\n"); // debug
 		// PANIC("todo");l
 		// 페이지 쫒아내기 정책 실행
-		if (!(frame = vm_evict_frame()))
+		frame = vm_evict_frame();
+
+		// 스왑 공간까지 바닥나 쫓아낼 수 없으면 프로세스 하나를 죽여 프레임을 돌려받는다.
+		// 현재 스레드가 골라졌으면 실패하고, 폴트 핸들러가 exit(-1)로 끝낸다.
+		if (frame == NULL && (!vm_oom_kill() || (paddr = palloc_get_page(PAL_USER)) == NULL))
 		{
-			// printf("희생자가 안나타나나?\n"); // debug
-			// PANIC("swap out 실패!!!!!\n");
 			return NULL;
 		}
-		// printf("vm_get_frame 실행\n");
-		paddr = frame->kva;
-		// printf("paddr: %p\n", paddr); // debug
 	}
-
-	frame = malloc(sizeof(struct frame)); // 프레임 할당
-	frame->kva = paddr;					  // 프레임 구조체 초기화
-	frame->page = NULL;
+	if (paddr != NULL)
+	{
+		// 물리 페이지 번호로 프레임 테이블 엔트리를 찾음
+		frame = &frame_table.frames[palloc_user_page_idx(paddr)];
+		frame_table.free_cnt--;
+	}
+	kswapd_wakeup();
 
 	ASSERT(frame != NULL);
 	ASSERT(frame->page == NULL);
+	ASSERT(frame->cnt == 0);
+	ASSERT(frame->inode == NULL);
+	ASSERT(frame->shm == NULL);
+	evict_policy->add(frame);
 	return frame;
 }
 
 /* Growing the stack. */
-static void
+static bool
 vm_stack_growth(void *addr UNUSED)
 {
+	// addr 주소를 포함하도록 스택 영역을 아래로 늘린다. 페이지는 각 페이지의 첫 폴트에서 만든다.
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vm_area *stack = vma_find(spt, (void *)USER_STACK - PGSIZE);
+	if (stack == NULL)
+	{
+		return false;
+	}
+	return vma_grow_down(spt, stack, pg_round_down(addr));
+}
+
+/* Handle the fault on write_protected page */
+// fork 이후 공유 중인 프레임에 쓰기가 발생하면 이 페이지만의 복사본을 만든다.
+static bool
+vm_handle_wp(struct page *page UNUSED)
+{
+	struct frame *old_frame = page->frame;
+	if (old_frame == NULL || !page->writable)
+	{
+		return false;
+	}
+	bool ksm = page->ksm;
+	page->ksm = false;
+
+	// 다른 프로세스가 이미 떠났다면 복사 없이 쓰기 권한만 되돌려준다.
+	// page cache 프레임은 파일 내용 그 자체이므로 공유한 채로 쓴다.
+	// zero page는 모두가 공유하므로 항상 복사한다.
+	if ((old_frame->cnt == 1 || old_frame->inode != NULL) && old_frame != &zero_frame)
+	{
+		return pml4_set_page(thread_current()->pml4, page->va, old_frame->kva, true);
+	}
 
-	void *addr_bottom = pg_round_down(addr);
+	// 새 프레임을 구하다가 복사할 원본이 쫓겨나지 않도록 복사가 끝날 때까지 고정한다.
+	old_frame->pin_cnt++;
+	struct frame *frame = vm_get_frame();
+	if (frame == NULL)
+	{
+		old_frame->pin_cnt--;
+		return false;
+	}
+	memcpy(frame->kva, old_frame->kva, PGSIZE);
+	old_frame->pin_cnt--;
+	// ksmd가 합친 프레임의 공유가 쓰기로 깨졌다.
+	if (ksm)
+	{
+		ksm_stats.unmerged++;
+	}
+
+	frame_detach(old_frame, page);
+	frame_attach(frame, page);
+	return pml4_set_page(thread_current()->pml4, page->va, frame->kva, true);
+}
 
-	while (!spt_find_page(&thread_current()->spt, addr_bottom))
+// 폴트 처리의 본체: PAGE를 적재하거나, NOT_PRESENT가 아니면 쓰기 보호를 푼다.
+// 주소 검사가 끝난 뒤 vm_lock을 잡고 부른다. 파일 페이지면 filesys_lock도 잡고 있어야 한다.
+// (페이지 폴트, vm_pin_range)
+static bool
+vm_resolve_fault(struct supplemental_page_table *spt, struct page *page, bool write, bool not_present)
+{
+	bool succ;
+	// OOM killer에게 선택된 프로세스는 더 이상 프레임을 받지 않는다. (락을 기다리는 동안 선택됐을 수도 있다.)
+	if (thread_current()->oom_killed)
+	{
+		succ = false;
+	}
+	else if (!not_present)
+	{
+		succ = vm_handle_wp(page);
+	}
+	// 아직 쓴 적 없는 스택/BSS 페이지를 읽기만 하면 공유 zero page로 충분하다.
+	else if (!write && VM_TYPE(page->operations->type) == VM_UNINIT && (page->uninit.type & VM_ZERO))
+	{
+		succ = vm_map_zero_page(page);
+	}
+	else
+	{
+		succ = vm_claim_fault_around(spt, page);
+	}
+	if (succ)
 	{
-		// printf("반복되는상황발생\n"); // debug
-		// addr 주소를 포함하도록 스택을 확장
-		if (vm_alloc_page(VM_MARKER_0 | VM_ANON, addr_bottom, true))
+		if (page->frame != NULL && page->frame != &zero_frame)
 		{
-			vm_claim_page(addr_bottom);
+			evict_policy->access(page->frame, page);
 		}
-		addr_bottom += PGSIZE;
+		vm_try_promote(spt, page);
 	}
+
+	return succ;
 }
 
-/* Handle the fault on write_protected page */
+// PAGE를 올리려면 파일을 읽을 수 있는지: 아직 파일 내용을 읽지 않은 페이지와,
+// 쫓겨나면 파일에서 다시 읽는 텍스트/mmap 페이지. 스왑에서 올라오는 익명 페이지는 아니다.
 static bool
-vm_handle_wp(struct page *page UNUSED)
+vm_page_reads_file(struct page *page)
 {
+	if (page->vma == NULL || page->vma->file == NULL)
+	{
+		return false;
+	}
+	// uninit, anon, file 페이지 모두 type 필드는 union의 같은 자리에 있다.
+	return (VM_TYPE(page->operations->type) == VM_UNINIT && page->uninit.init != NULL) ||
+		   (page->uninit.type & VM_TEXT) || VM_TYPE(page->uninit.type) == VM_FILE;
 }
 
 /* Return true on success */
@@ -330,7 +639,7 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 		return false; // 주소가 유저 공간이 아니면 실패
 	}
 
-	page = spt_find_page(spt, addr);
+	page = spt_get_page(spt, addr);
 	if (page == NULL)
 	{
 
@@ -342,13 +651,21 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 		// }
 
 		// 스택제한사이즈확인 && 주소접근이 스택영역인지 확인후 페이지 할당
-		if ((USER_STACK - USER_STACK_LIMIT) <= addr && (rsp <= addr || (rsp - 8) == addr) && addr <= USER_STACK)
+		if (!((USER_STACK - USER_STACK_LIMIT) <= addr && (rsp <= addr || (rsp - 8) == addr) && addr <= USER_STACK))
 		{
-			vm_stack_growth(addr);
-			return true;
+			// printf("스택접근?\n");
+			return false; // 페이지를 찾을 수 없으면 실패
+		}
+		if (!vm_stack_growth(addr))
+		{
+			return false;
+		}
+		// 늘어난 스택 페이지도 아래에서 다른 페이지와 똑같이 claim 한다.
+		page = spt_get_page(spt, addr);
+		if (page == NULL)
+		{
+			return false;
 		}
-		// printf("스택접근?\n");
-		return false; // 페이지를 찾을 수 없으면 실패
 	}
 	if (write && !page->writable)
 	{
@@ -358,35 +675,17 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 
 	// printf("%d, %d\n", write, page->writable);
 
-	bool flag = false;
-	// merger test lock
-	if (!lock_held_by_current_thread(&filesys_lock))
-	{
-		lock_acquire(&filesys_lock);
-		flag = true;
-	}
-
-	if (vm_do_claim_page(page))
-	{
-
-		if (flag)
-		{
-			lock_release(&filesys_lock);
-			flag = false;
-		}
-		// printf("do claim 성공\n"); // debug
-		return true;
-	}
-	else
+	// 페이지가 올라와 있는데 폴트가 났다면 COW 공유 페이지에 대한 쓰기
+	if (!not_present && !write)
 	{
-		if (flag)
-		{
-			lock_release(&filesys_lock);
-			flag = false;
-		}
-		// printf("do claim 실패\n"); // debug
 		return false;
 	}
+
+	// 파일에서 읽어야 하는 페이지만 filesys_lock을 기다린다.
+	int held = vm_lock_acquire(vm_page_reads_file(page));
+	bool succ = vm_resolve_fault(spt, page, write, not_present);
+	vm_lock_release(held);
+	return succ;
 }
 
 /* Free the page.
@@ -394,7 +693,18 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 void vm_dealloc_page(struct page *page)
 {
 	destroy(page);
-	free(page);
+	slab_free(&page_slab, page);
+}
+
+// lazy_load_info는 페이지마다 하나씩 만들어지므로 slab cache에서 받는다.
+void *vm_load_info_alloc(void)
+{
+	return slab_alloc(&aux_slab);
+}
+
+void vm_load_info_free(void *info)
+{
+	slab_free(&aux_slab, info);
 }
 
 /* Claim the page that allocate on VA. */
@@ -405,75 +715,1140 @@ bool vm_claim_page(void *va UNUSED)
 	/* TODO: Fill this function */
 	// unchecked : 확실하지 않음.
 	struct thread *t = thread_current();
-	page = spt_find_page(&t->spt, va);
+	page = spt_get_page(&t->spt, va);
 
 	if (page == NULL)
 	{
 		return false;
 	}
-	return vm_do_claim_page(page);
+	int held = vm_lock_acquire(vm_page_reads_file(page));
+	bool succ = vm_do_claim_page(page);
+	vm_lock_release(held);
+	return succ;
 }
 
-/* Claim the PAGE and set up the mmu. */
+// 공유 익명 영역(MAP_SHARED)의 PAGE를 claim한다. 다른 프로세스가 이미 올려 둔 프레임이 있으면
+// 그것을 함께 매핑하고, 없으면 새 프레임을 스왑 슬롯에서 읽거나 0으로 채워 공유 객체에 넣는다.
 static bool
-vm_do_claim_page(struct page *page)
+vm_claim_shared_page(struct page *page)
 {
-	struct frame *frame = vm_get_frame();
+	struct vm_shm *shm = page->vma->shm;
+	size_t idx = (page->va - page->vma->start) / PGSIZE;
+	struct vm_shm_slot *slot = &shm->slots[idx];
 
-	/* Set links */
-	frame->page = page;
-	page->frame = frame;
-	// list_push_back(&frame_table, &page->frame_elem);
+	if (slot->frame == NULL)
+	{
+		struct frame *frame = vm_get_frame();
+		if (frame == NULL)
+		{
+			return false;
+		}
+		if (slot->sw_idx != SIZE_MAX)
+		{
+			anon_swap_read(slot->sw_idx, frame->kva);
+			anon_swap_free(slot->sw_idx);
+			slot->sw_idx = SIZE_MAX;
+		}
+		else
+		{
+			memset(frame->kva, 0, PGSIZE);
+		}
+		frame->shm = shm;
+		frame->shm_idx = idx;
+		slot->frame = frame;
+	}
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	// MMU 세팅: 가상 주소와 물리 주소를 매핑한 정보를 페이지 테이블에 추가해야한다.
-	list_push_back(&frame_table, &page->frame_elem);
+	// 처음 claim하는 페이지는 anon 페이지로 바꾼다. 내용은 공유 객체가 관리하므로 읽을 것이 없다.
+	if (VM_TYPE(page->operations->type) == VM_UNINIT && !swap_in(page, slot->frame->kva))
+	{
+		return false;
+	}
+	frame_attach(slot->frame, page);
+	page->is_loaded = true;
+	return pml4_set_page(thread_current()->pml4, page->va, slot->frame->kva, page->writable);
+}
 
-	pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
-	// 프레임을 할당받고, 프레임 테이블에 페이지 포인터를 넣어줌.
+// 공유 익명 프레임을 스왑 슬롯에 쓰고 모든 프로세스의 매핑을 지운다.
+// 스왑 공간이 없으면 매핑을 되돌리고 false.
+static bool
+vm_evict_shared(struct frame *frame)
+{
+	struct vm_shm_slot *slot = &frame->shm->slots[frame->shm_idx];
+	struct list_elem *e;
 
-	return swap_in(page, frame->kva);
-}
+	// 쓰는 도중 다른 프로세스가 고치지 못하도록 먼저 매핑을 끊는다.
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+		pml4_clear_page(page->thread->pml4, page->va);
+	}
 
-/* --------------------------project3 추가 함수 ------------------------------- */
+	size_t idx = anon_swap_write(frame->kva);
+	if (idx == BITMAP_ERROR)
+	{
+		for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+		{
+			struct page *page = list_entry(e, struct page, frame_elem);
+			pml4_set_page(page->thread->pml4, page->va, frame->kva, page->writable);
+		}
+		return false;
+	}
 
-// 입력된 두 hash_elem의 vaddr 비교하는 함수
-static bool compare_hash_func(const struct hash_elem *a, const struct hash_elem *b, void *aux)
-{
-	/* hash_entry()로 각각의 element에 대한 page 구조체를 얻은 후 vaddr 비교
-	 * a가 b보다 작으면 true
-	 * a가 b보다 크거나 같으면 false*/
-	struct page *page_a = hash_entry(a, struct page, hash_elem);
-	struct page *page_b = hash_entry(b, struct page, hash_elem);
-	return page_a->va < page_b->va;
+	slot->sw_idx = idx;
+	slot->frame = NULL;
+	frame->shm = NULL;
+	while (!list_empty(&frame->pages))
+	{
+		struct page *page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+		frame_detach(frame, page);
+		page->frame = NULL;
+		page->is_loaded = false;
+	}
+	return true;
 }
 
-// page의 vaddr을 인자값으로 hash_int() 함수를 사용하여 해시 값 반환
-static uint64_t get_hash_func(const struct hash_elem *e, void *aux)
+// fork 후 COW로 여러 프로세스가 함께 가진 익명 프레임을 한 번만 스왑 슬롯에 쓰고,
+// 모든 페이지가 그 슬롯을 함께 가리키게 한 뒤 매핑을 지운다. 스왑 공간이 없으면 매핑을 되돌리고 false.
+static bool
+vm_evict_cow(struct frame *frame)
 {
-	/* hash_entry()로 각각의 element에 대한 page 구조체 검색
-	 * hash_int()를 이용해서 page의 멤버 vaddr에 대한 해시값을 구하고 반환*/
-	struct page *page_a = hash_entry(e, struct page, hash_elem);
-	uint64_t hash_value = hash_int(page_a->va);
-	return hash_value;
-}
+	struct list_elem *e;
 
-/*------------------------project3 추가 함수 끝------------------------------*/
+	// 각 페이지가 따로 가지던 슬롯은 공유 슬롯으로 바뀌므로 먼저 놓는다.
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+		pml4_clear_page(page->thread->pml4, page->va);
+		anon_forget_slot(page);
+	}
 
-static bool
-child_copy_pm(struct page *page, void *aux)
-{
-	page->is_loaded = true;
-	memcpy(page->frame->kva, aux, PGSIZE);
+	size_t idx = anon_swap_write(frame->kva);
+	if (idx == BITMAP_ERROR)
+	{
+		// COW 매핑은 읽기 전용이다. 슬롯이 없으므로 다음 스왑아웃 때 다시 쓴다.
+		for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+		{
+			struct page *page = list_entry(e, struct page, frame_elem);
+			pml4_set_page(page->thread->pml4, page->va, frame->kva, false);
+		}
+		return false;
+	}
+
+	while (!list_empty(&frame->pages))
+	{
+		struct page *page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+		anon_share_slot(page, idx);
+		frame_detach(frame, page);
+		page->frame = NULL;
+		page->is_loaded = false;
+		page->ksm = false;
+	}
+	// anon_swap_write가 잡은 참조는 페이지들에 넘겼다.
+	anon_swap_free(idx);
 	return true;
 }
 
-/* Initialize new supplemental page table */
-void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
+// PAGE_CNT 페이지짜리 공유 객체를 만든다. 페이지는 처음 폴트에서 0으로 채워진다.
+struct vm_shm *
+vm_shm_create(size_t page_cnt)
+{
+	struct vm_shm *shm = malloc(sizeof *shm + page_cnt * sizeof shm->slots[0]);
+	if (shm == NULL)
+	{
+		return NULL;
+	}
+	shm->ref = 1;
+	shm->page_cnt = page_cnt;
+	for (size_t i = 0; i < page_cnt; i++)
+	{
+		shm->slots[i].frame = NULL;
+		shm->slots[i].sw_idx = SIZE_MAX;
+	}
+	return shm;
+}
+
+// 영역 하나가 SHM을 놓는다. 마지막 영역이면 남은 프레임과 스왑 슬롯을 모두 돌려준다.
+// 영역의 페이지들은 이미 지워져 있어야 하며, vm_lock을 잡고 부른다.
+void vm_shm_put(struct vm_shm *shm)
+{
+	if (--shm->ref > 0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < shm->page_cnt; i++)
+	{
+		struct frame *frame = shm->slots[i].frame;
+		if (frame != NULL)
+		{
+			ASSERT(frame->cnt == 0);
+			frame->shm = NULL;
+			frame_free(frame);
+		}
+		if (shm->slots[i].sw_idx != SIZE_MAX)
+		{
+			anon_swap_free(shm->slots[i].sw_idx);
+		}
+	}
+	free(shm);
+}
+
+// ksmd가 frame table을 훑을 때 쓴다. vm_lock을 잡고 부른다.
+size_t vm_frame_cnt(void)
+{
+	return frame_table.size;
+}
+
+struct frame *
+vm_frame_at(size_t idx)
+{
+	ASSERT(idx < frame_table.size);
+	return &frame_table.frames[idx];
+}
+
+struct frame *
+vm_zero_frame(void)
+{
+	return &zero_frame;
+}
+
+/* ksmd: PAGE를 같은 내용을 담은 프레임 TO로 옮겨 읽기 전용으로 매핑하고,
+ * 원래 프레임을 쓰는 페이지가 더 없으면 해제한다. 다음 쓰기에서 vm_handle_wp가 복사한다. */
+void vm_frame_merge(struct frame *to, struct page *page)
+{
+	struct frame *from = page->frame;
+	ASSERT(from != to && from->pin_cnt == 0 && from->shm == NULL && from->inode == NULL);
+
+	// 옮긴 뒤에는 dirty 비트로 스왑 슬롯이 최신인지 알 수 없으므로 버린다.
+	anon_forget_slot(page);
+	frame_detach(from, page);
+	frame_attach(to, page);
+	pml4_set_page(page->thread->pml4, page->va, to->kva, false);
+	if (from->cnt == 0)
+	{
+		frame_free(from);
+	}
+}
+
+// 매핑된 커널 주소 KVA의 프레임
+static struct frame *
+frame_from_kva(void *kva)
+{
+	if (pg_round_down(kva) == zero_frame.kva)
+	{
+		return &zero_frame;
+	}
+	return &frame_table.frames[palloc_user_page_idx(pg_round_down(kva))];
+}
+
+// VA의 페이지를 (WRITE면 쓸 수 있게) 올리고 그 프레임을 고정한다.
+// 이미 그렇게 매핑돼 있으면 페이지 테이블만 보고, 아니면 폴트와 같은 방법으로 적재한다.
+static bool
+vm_pin_page(struct supplemental_page_table *spt, void *va, bool write)
+{
+	uint64_t *pml4 = thread_current()->pml4;
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)va, 0);
+	bool present = pte != NULL && (*pte & PTE_P);
+
+	if (!present || (write && !(*pte & PTE_W)))
+	{
+		struct page *page = spt_get_page(spt, va);
+		if (page == NULL || (write && !page->writable) || !vm_resolve_fault(spt, page, write, !present))
+		{
+			return false;
+		}
+	}
+	frame_from_kva(pml4_get_page(pml4, va))->pin_cnt++;
+	return true;
+}
+
+// [START, END)의 페이지들의 고정을 푼다.
+static void
+vm_unpin_pages(void *start, const void *end)
+{
+	uint64_t *pml4 = thread_current()->pml4;
+	for (void *va = start; va < end; va += PGSIZE)
+	{
+		struct frame *frame = frame_from_kva(pml4_get_page(pml4, va));
+		ASSERT(frame->pin_cnt > 0);
+		frame->pin_cnt--;
+	}
+}
+
+/* 시스템 콜이 유저 버퍼 [UADDR, UADDR + SIZE)를 커널에서 직접 읽고 쓸 수 있도록 범위 전체를
+ * 한 번에 검사하고 적재해서 고정한다. 고정된 프레임은 쫓겨나거나 옮겨지지 않으므로 이후의 복사는
+ * 페이지 폴트도, 페이지마다의 해시 검색도 없이 락 없이 그대로 진행된다.
+ * 이미 올라와 있는 페이지는 페이지 테이블만 보고, 영역(VMA)은 경계를 넘을 때만 찾는다.
+ * 범위의 한 바이트라도 영역 밖이거나, WRITE인데 쓸 수 없으면 고정한 것을 풀고 false.
+ * 끝나면 vm_unpin_range로 풀어야 한다. */
+bool vm_pin_range(const void *uaddr, size_t size, bool write)
+{
+	if (size == 0)
+	{
+		return true;
+	}
+	const void *end = uaddr + size;
+	if (uaddr == NULL || end < uaddr || !is_user_vaddr(uaddr) || !is_user_vaddr(end - 1))
+	{
+		return false;
+	}
+
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vm_area *vma = NULL;
+	void *va;
+	bool succ = true;
+
+	// 파일 영역이 섞여 있을 때만 filesys_lock까지 잡는다.
+	bool file = false;
+	for (va = pg_round_down(uaddr); va < end; va = vma->end)
+	{
+		vma = vma_find(spt, va);
+		if (vma == NULL)
+		{
+			return false;
+		}
+		file |= vma->file != NULL;
+	}
+	int held = vm_lock_acquire(file);
+
+	vma = NULL;
+	for (va = pg_round_down(uaddr); va < end; va += PGSIZE)
+	{
+		if (vma == NULL || va >= vma->end)
+		{
+			vma = vma_find(spt, va);
+		}
+		if (vma == NULL || (write && !vma->writable) || !vm_pin_page(spt, va, write))
+		{
+			succ = false;
+			break;
+		}
+	}
+	if (!succ)
+	{
+		vm_unpin_pages(pg_round_down(uaddr), va);
+	}
+
+	vm_lock_release(held);
+	return succ;
+}
+
+// vm_pin_range로 고정한 범위를 푼다.
+void vm_unpin_range(const void *uaddr, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	int held = vm_lock_acquire(false);
+	vm_unpin_pages(pg_round_down(uaddr), uaddr + size);
+	vm_lock_release(held);
+}
+
+/* Claim the PAGE and set up the mmu. */
+static bool
+vm_do_claim_page(struct page *page)
+{
+	// uninit, anon, file 페이지 모두 type 필드는 union의 같은 자리에 있다.
+	if ((page->uninit.type & VM_TEXT) || VM_TYPE(page->uninit.type) == VM_FILE)
+	{
+		return vm_claim_cached_page(page);
+	}
+	if (page->uninit.type & VM_SHARED)
+	{
+		return vm_claim_shared_page(page);
+	}
+
+	struct frame *frame = vm_get_frame();
+	if (frame == NULL)
+	{
+		return false;
+	}
+
+	// 초기화 함수가 없는 익명 페이지는 내용을 채울 곳이 없으므로 직접 0으로 지운다.
+	if (VM_TYPE(page->operations->type) == VM_UNINIT && page->uninit.init == NULL)
+	{
+		memset(frame->kva, 0, PGSIZE);
+	}
+
+	/* Set links */
+	frame_attach(frame, page);
+
+	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	// MMU 세팅: 가상 주소와 물리 주소를 매핑한 정보를 페이지 테이블에 추가해야한다.
+	pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
+	// 방금 올라온 페이지는 참조된 것으로 보고 한 번의 기회를 준다.
+	pml4_set_accessed(thread_current()->pml4, page->va, true);
+
+	return swap_in(page, frame->kva);
+}
+
+// PAGE를 anon 페이지로 초기화하고 공유 zero page에 읽기 전용으로 매핑한다.
+// 첫 쓰기는 vm_handle_wp가 새 프레임으로 복사해 처리한다.
+static bool
+vm_map_zero_page(struct page *page)
+{
+	if (!swap_in(page, zero_frame.kva))
+	{
+		return false;
+	}
+
+	frame_attach(&zero_frame, page);
+	return pml4_set_page(thread_current()->pml4, page->va, zero_frame.kva, false);
+}
+
+// 파일 데이터 페이지(mmap, 읽기 전용 실행 파일)를 claim한다. 같은 (inode, offset)을
+// 이미 누가 매핑하고 있으면 page cache의 그 프레임을 함께 매핑하고, 없으면 읽은 뒤 등록한다.
+// uninit이든 쫓겨난 anon/file 페이지든 init과 aux는 union의 같은 자리에 남아 있다.
+static bool
+vm_claim_cached_page(struct page *page)
+{
+	lazy_load_info *info = page->uninit.aux;
+	struct inode *inode = file_get_inode(info->file);
+	off_t ofs = info->offset;
+	size_t read_bytes = info->read_bytes;
+
+	// 같은 파일 페이지라도 읽은 길이가 다르면 내용이 다르므로 따로 읽는다.
+	struct frame *cached = page_cache_lookup(inode, ofs);
+	bool shared = cached != NULL && cached->read_bytes == read_bytes;
+	struct frame *frame = shared ? cached : vm_get_frame();
+	if (frame == NULL)
+	{
+		return false;
+	}
+
+	frame_attach(frame, page);
+	pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
+	pml4_set_accessed(thread_current()->pml4, page->va, true);
+
+	// 첫 폴트라면 anon/file 페이지로 바꾼다. init은 부르지 않으므로 다시 읽을 때도 쓸 수 있다.
+	if (VM_TYPE(page->operations->type) == VM_UNINIT)
+	{
+		page->is_loaded = true;
+		if (!page->uninit.page_initializer(page, page->uninit.type, frame->kva))
+		{
+			return false;
+		}
+	}
+	if (shared)
+	{
+		return true;
+	}
+
+	// file_backed_initializer가 aux를 복사본으로 바꾸므로 초기화 뒤에 다시 읽는다.
+	if (!page->uninit.init(page, page->uninit.aux))
+	{
+		return false;
+	}
+	// 오프셋이 페이지 단위가 아닌 mmap은 캐시하지 않는다.
+	if (cached == NULL && pg_ofs(ofs) == 0)
+	{
+		page_cache_insert(frame, inode, ofs, read_bytes);
+	}
+	return true;
+}
+
+// PAGE가 속한 2MB 영역의 페이지가 모두 이 프로세스만의 익명 프레임에 올라와 있으면
+// 정렬된 연속 프레임으로 모은 뒤 PDE 하나로 매핑한다. 프레임 테이블에는 4KB 프레임
+// 512개로 그대로 남으므로, 한 페이지를 쫓아내거나 권한을 바꾸면 mmu가 다시 쪼갠다.
+static void
+vm_try_promote(struct supplemental_page_table *spt, struct page *page)
+{
+	if (!vm_huge_pages)
+	{
+		return;
+	}
+
+	// 영역의 양 끝 페이지 폴트에서만 검사해 폴트마다 512번 찾지 않도록 한다.
+	void *base = (void *)((uint64_t)page->va & ~(HUGE_PGSIZE - 1));
+	if (page->va != base && page->va != base + HUGE_PGSIZE - PGSIZE)
+	{
+		return;
+	}
+	uint64_t *pml4 = thread_current()->pml4;
+	if (pml4_is_huge(pml4, base))
+	{
+		return;
+	}
+
+	// 이미 정렬된 연속 프레임에 있는지도 함께 본다.
+	void *kva = NULL;
+	bool contiguous = true;
+	for (size_t i = 0; i < HUGE_PGCNT; i++)
+	{
+		struct page *p = spt_find_page(spt, base + i * PGSIZE);
+		if (p == NULL || !vm_promotable(p, page->writable))
+		{
+			return;
+		}
+		// PDE 하나로 합치면 페이지별 dirty 비트가 사라지므로, 고친 페이지의 낡은 스왑 슬롯은 미리 버린다.
+		if (pml4_is_dirty(pml4, p->va))
+		{
+			anon_forget_slot(p);
+		}
+		if (i == 0)
+		{
+			kva = p->frame->kva;
+			contiguous = (vtop(kva) & (HUGE_PGSIZE - 1)) == 0;
+		}
+		else if (p->frame->kva != kva + i * PGSIZE)
+		{
+			contiguous = false;
+		}
+	}
+
+	if (!contiguous)
+	{
+		kva = palloc_get_aligned(PAL_USER, HUGE_PGCNT);
+		if (kva == NULL)
+		{
+			return;
+		}
+		frame_table.free_cnt -= HUGE_PGCNT;
+
+		// 각 페이지를 새 프레임으로 옮기고 원래 프레임은 돌려준다.
+		size_t idx = palloc_user_page_idx(kva);
+		for (size_t i = 0; i < HUGE_PGCNT; i++)
+		{
+			struct page *p = spt_find_page(spt, base + i * PGSIZE);
+			struct frame *old = p->frame;
+			struct frame *frame = &frame_table.frames[idx + i];
+
+			memcpy(frame->kva, old->kva, PGSIZE);
+			evict_policy->add(frame);
+			frame_detach(old, p);
+			frame_attach(frame, p);
+			pml4_set_page(pml4, p->va, frame->kva, p->writable);
+			frame_free(old);
+		}
+	}
+
+	pml4_set_huge_page(pml4, base, kva, page->writable);
+}
+
+// huge page로 묶을 수 있는 페이지인지: 쓰기 권한이 같고, 다른 곳과 공유하지 않는 익명 프레임
+static bool
+vm_promotable(struct page *page, bool writable)
+{
+	struct frame *frame = page->frame;
+	return frame != NULL && frame != &zero_frame && frame->cnt == 1 && frame->inode == NULL && frame->shm == NULL &&
+		   frame->pin_cnt == 0 &&
+		   VM_TYPE(page->operations->type) == VM_ANON && !(page->anon.type & VM_TEXT) &&
+		   page->writable == writable;
+}
+
+// PAGE를 claim하고, 파일에서 읽는 페이지라면 같은 파일의 이어지는 uninit 페이지들도 함께 적재한다.
+// 락을 한 번 잡은 채로 윈도우 전체를 읽으므로 페이지마다 트랩이 나지 않는다.
+static bool
+vm_claim_fault_around(struct supplemental_page_table *spt, struct page *page)
+{
+	// 디스크에서 스왑인하는 페이지라면 이웃 슬롯도 함께 읽는다.
+	// 스왑인이 슬롯을 돌려줄 수 있으므로 슬롯 번호를 먼저 기억해 둔다.
+	if (VM_TYPE(page->operations->type) == VM_ANON && page->frame == NULL &&
+		page->zswap == NULL && page->sw_valid)
+	{
+		size_t idx = page->sw_idx;
+		if (!vm_do_claim_page(page))
+		{
+			return false;
+		}
+		vm_swap_readahead(spt, page, idx);
+		return true;
+	}
+
+	// claim하면 uninit 필드가 덮어써지므로 먼저 기억해 둔다.
+	vm_initializer *init = NULL;
+	lazy_load_info base;
+	if (VM_TYPE(page->operations->type) == VM_UNINIT && page->uninit.init != NULL && page->uninit.aux != NULL)
+	{
+		init = page->uninit.init;
+		base = *(lazy_load_info *)page->uninit.aux;
+	}
+
+	if (!vm_do_claim_page(page))
+	{
+		return false;
+	}
+	if (init == NULL || fault_around_max <= 1)
+	{
+		return true;
+	}
+
+	// 지난 윈도우 바로 뒤에서 폴트가 났으면 순차 접근으로 보고 윈도우를 두 배로 키운다.
+	size_t window = FAULT_AROUND_INIT;
+	if (page->va == spt->fault_around_next && spt->fault_around_window != 0)
+	{
+		window = spt->fault_around_window * 2;
+	}
+	if (window > fault_around_max)
+	{
+		window = fault_around_max;
+	}
+
+	// 파일 내용이 있는 같은 영역 안에서만 미리 읽는다. 아직 없는 페이지는 여기서 만든다.
+	struct vm_area *vma = page->vma;
+	size_t i;
+	for (i = 1; i < window; i++)
+	{
+		void *va = page->va + i * PGSIZE;
+		if (vma == NULL || va >= vma->end || (size_t)(va - vma->start) >= vma->read_bytes)
+		{
+			break;
+		}
+		struct page *next = spt_get_page(spt, va);
+		if (next == NULL || VM_TYPE(next->operations->type) != VM_UNINIT || next->uninit.init != init)
+		{
+			break;
+		}
+		lazy_load_info *info = next->uninit.aux;
+		if (info == NULL || info->file != base.file || info->offset != base.offset + (off_t)(i * PGSIZE))
+		{
+			break;
+		}
+		// 미리 읽기 위해 다른 페이지를 쫓아내지는 않는다.
+		if (frame_table.free_cnt <= kswapd_low_wmark)
+		{
+			break;
+		}
+		if (!vm_do_claim_page(next))
+		{
+			break;
+		}
+		// 아직 쓰이지 않은 페이지는 clock이 먼저 가져갈 수 있게 accessed 비트를 지운다.
+		pml4_set_accessed(thread_current()->pml4, next->va, false);
+	}
+
+	spt->fault_around_next = page->va + i * PGSIZE;
+	spt->fault_around_window = window;
+	return true;
+}
+
+// 스왑 readahead: PAGE(슬롯 IDX에서 막 읽음) 뒤로 이어지는 페이지들 중 디스크에서도 바로 다음
+// 슬롯에 있는 것들을 함께 읽는다. 묶음 할당 덕분에 순차 접근하던 배열은 슬롯도 이어져 있어
+// 탐색 없이 연속으로 읽힌다. 미리 읽은 페이지는 슬롯을 가진 깨끗한 페이지이므로 쓰이지 않으면
+// 쓰기 없이 다시 버려진다.
+static void
+vm_swap_readahead(struct supplemental_page_table *spt, struct page *page, size_t idx)
+{
+	for (size_t i = 1; i < SWAP_READAHEAD; i++)
+	{
+		struct page *next = spt_find_page(spt, page->va + i * PGSIZE);
+		if (next == NULL || VM_TYPE(next->operations->type) != VM_ANON || next->frame != NULL ||
+			next->zswap != NULL || !next->sw_valid || next->sw_idx != idx + i * SECTORS_PER_PAGE)
+		{
+			break;
+		}
+		// 미리 읽기 위해 다른 페이지를 쫓아내지는 않는다.
+		if (frame_table.free_cnt <= kswapd_low_wmark)
+		{
+			break;
+		}
+		if (!vm_do_claim_page(next))
+		{
+			break;
+		}
+		pml4_set_accessed(thread_current()->pml4, next->va, false);
+	}
+}
+
+/* --------------------------project3 추가 함수 ------------------------------- */
+
+// 입력된 두 hash_elem의 vaddr 비교하는 함수
+static bool compare_hash_func(const struct hash_elem *a, const struct hash_elem *b, void *aux)
+{
+	/* hash_entry()로 각각의 element에 대한 page 구조체를 얻은 후 vaddr 비교
+	 * a가 b보다 작으면 true
+	 * a가 b보다 크거나 같으면 false*/
+	struct page *page_a = hash_entry(a, struct page, hash_elem);
+	struct page *page_b = hash_entry(b, struct page, hash_elem);
+	return page_a->va < page_b->va;
+}
+
+// page의 vaddr을 인자값으로 hash_int() 함수를 사용하여 해시 값 반환
+static uint64_t get_hash_func(const struct hash_elem *e, void *aux)
+{
+	/* hash_entry()로 각각의 element에 대한 page 구조체 검색
+	 * hash_int()를 이용해서 page의 멤버 vaddr에 대한 해시값을 구하고 반환*/
+	struct page *page_a = hash_entry(e, struct page, hash_elem);
+	uint64_t hash_value = hash_int(page_a->va);
+	return hash_value;
+}
+
+/*------------------------project3 추가 함수 끝------------------------------*/
+
+// 부모가 이미 적재한 페이지를 자식과 읽기 전용으로 공유한다. (copy-on-write)
+static bool
+spt_share_page(struct supplemental_page_table *dst, struct page *parent_page)
+{
+	struct thread *parent = parent_page->thread;
+	struct frame *frame = parent_page->frame;
+
+	struct page *page = slab_alloc(&page_slab);
+	if (page == NULL)
+	{
+		return false;
+	}
+	memcpy(page, parent_page, sizeof(struct page));
+	page->thread = thread_current();
+	// 스왑 슬롯은 부모의 것이다.
+	page->sw_valid = false;
+	page->zswap = NULL;
+	page->ksm = false;
+
+	// 파일 페이지의 aux는 destroy에서 해제되므로 자식이 따로 가진다.
+	bool is_file = page_get_type(parent_page) == VM_FILE;
+	if (is_file)
+	{
+		page->file.aux = vm_load_info_alloc();
+		if (page->file.aux == NULL)
+		{
+			goto err;
+		}
+		memcpy(page->file.aux, parent_page->file.aux, sizeof(lazy_load_info));
+	}
+
+	// 양쪽 모두 읽기 전용으로 매핑해서 첫 쓰기에서 vm_handle_wp가 불리도록 한다.
+	if (!pml4_set_page(page->thread->pml4, page->va, frame->kva, false))
+	{
+		goto err;
+	}
+	if (!spt_insert_page(dst, page))
+	{
+		pml4_clear_page(page->thread->pml4, page->va);
+		goto err;
+	}
+
+	// 부모의 dirty 비트는 파일 write back에 필요하므로 보존한다.
+	bool dirty = pml4_is_dirty(parent->pml4, parent_page->va);
+	pml4_set_page(parent->pml4, parent_page->va, frame->kva, false);
+	if (dirty)
+	{
+		pml4_set_dirty(parent->pml4, parent_page->va, true);
+	}
+
+	frame_attach(frame, page);
+	return true;
+
+err:
+	if (is_file)
+	{
+		vm_load_info_free(page->file.aux);
+	}
+	slab_free(&page_slab, page);
+	return false;
+}
+
+// 부모가 스왑(zswap 또는 디스크)으로 내보낸 익명 페이지를 자식의 새 프레임에 읽어 온다.
+// 슬롯은 부모의 것으로 남겨 둔다.
+static bool
+spt_copy_swapped_page(struct supplemental_page_table *dst, struct page *parent_page)
+{
+	if (!vm_alloc_page_with_initializer(parent_page->anon.type & ~VM_TEXT, parent_page->va,
+										parent_page->writable, NULL, NULL))
+	{
+		return false;
+	}
+	struct page *page = spt_find_page(dst, parent_page->va);
+	if (!vm_do_claim_page(page))
+	{
+		return false;
+	}
+
+	// 프레임을 구하는 동안 zswap이 부모의 항목을 디스크로 내렸을 수 있으니 지금 위치에서 읽는다.
+	if (parent_page->zswap != NULL)
+	{
+		zswap_read(parent_page, page->frame->kva);
+	}
+	else
+	{
+		ASSERT(parent_page->sw_valid);
+		anon_swap_read(parent_page->sw_idx, page->frame->kva);
+	}
+	return true;
+}
+
+// 페이지와 프레임의 연결을 끊는다.
+// 다른 페이지가 아직 공유 중이면 매핑만 지우고, 마지막이면 물리 페이지까지 해제한다.
+static void
+vm_release_frame(struct page *page)
+{
+	struct frame *frame = page->frame;
+	if (frame == NULL)
+	{
+		return;
+	}
+
+	frame_detach(frame, page);
+	page->frame = NULL;
+	if (page->thread->pml4 != NULL)
+	{
+		pml4_clear_page(page->thread->pml4, page->va);
+	}
+
+	// 공유 익명 프레임은 매핑이 모두 없어져도 공유 객체가 가지고 있다.
+	if (frame->cnt == 0 && frame != &zero_frame && frame->shm == NULL)
+	{
+		// 떠나는 매핑들이 각자 write back 했으므로 바로 버린다.
+		if (frame->inode != NULL)
+		{
+			page_cache_remove(frame);
+		}
+		frame_free(frame);
+	}
+}
+
+// OOM killer가 희생자를 고르는 동안의 상태
+struct oom_scan
+{
+	struct thread *victim; // 지금까지 가장 많이 쓰는 프로세스
+	size_t usage;		   // 그 프로세스의 rss + swap_cnt
+};
+
+// 유저 프로세스 T가 지금까지 본 것보다 메모리를 많이 쓰면 희생자로 기억한다.
+static void
+oom_scan_thread(struct thread *t, void *aux)
+{
+	struct oom_scan *scan = aux;
+	if (t->pml4 == NULL || t->oom_killed)
+	{
+		return;
+	}
+	size_t usage = t->spt.rss + t->spt.swap_cnt;
+	if (usage > scan->usage)
+	{
+		scan->victim = t;
+		scan->usage = usage;
+	}
+}
+
+// VICTIM 혼자 쓰는 익명 프레임을 모두 회수한다. 내용은 버려지므로 VICTIM은 다시
+// 폴트가 나면 종료된다. 스왑 슬롯과 압축 항목은 프로세스가 끝날 때 돌려받는다.
+// 회수한 프레임 수를 반환한다.
+static size_t
+vm_oom_reap(struct thread *victim)
+{
+	size_t freed = 0;
+	for (size_t i = 0; i < frame_table.size; i++)
+	{
+		struct frame *frame = &frame_table.frames[i];
+		struct page *page = frame->page;
+		if (page == NULL || page->thread != victim || frame->cnt != 1 || frame->inode != NULL || frame->shm != NULL ||
+			frame->pin_cnt > 0 ||
+			VM_TYPE(page->operations->type) != VM_ANON || (page->anon.type & VM_TEXT))
+		{
+			continue;
+		}
+		vm_release_frame(page);
+		page->is_loaded = false;
+		freed++;
+	}
+	return freed;
+}
+
+/* 스왑 공간까지 모두 차서 프레임을 구할 수 없을 때 불린다. 메모리(rss + swap)를 가장
+ * 많이 쓰는 유저 프로세스를 골라 죽인다. 희생자가 다른 프로세스면 그 익명 프레임을
+ * 바로 회수하고 true를 반환한다. 희생자가 현재 스레드이거나 고를 프로세스가 없으면
+ * false이며, 현재 스레드의 폴트가 실패해 exit(-1)로 끝난다.
+ * vm_lock을 잡고 불리므로 희생자는 그동안 스스로 페이지를 지우지 못한다. */
+static bool
+vm_oom_kill(void)
+{
+	for (;;)
+	{
+		struct oom_scan scan = {NULL, 0};
+		enum intr_level old_level = intr_disable();
+		thread_foreach(oom_scan_thread, &scan);
+		intr_set_level(old_level);
+
+		if (scan.victim == NULL)
+		{
+			return false;
+		}
+		scan.victim->oom_killed = true;
+		if (scan.victim == thread_current())
+		{
+			return false;
+		}
+		// 공유 프레임뿐이라 회수한 것이 없으면 다음 희생자를 고른다.
+		if (vm_oom_reap(scan.victim) > 0)
+		{
+			return true;
+		}
+	}
+}
+
+// user pool 크기만큼 프레임 배열을 만든다.
+static void
+frame_table_init(void)
+{
+	frame_table.size = palloc_user_page_cnt();
+	frame_table.frames = calloc(frame_table.size, sizeof(struct frame));
+	if (frame_table.frames == NULL)
+	{
+		PANIC("frame table 할당 실패");
+	}
+
+	for (size_t i = 0; i < frame_table.size; i++)
+	{
+		struct frame *frame = &frame_table.frames[i];
+		frame->kva = palloc_user_page(i);
+		list_init(&frame->pages);
+	}
+	frame_table.free_cnt = palloc_user_free_cnt();
+}
+
+// watermark 기본값을 정하고 kswapd 스레드를 띄운다.
+static void
+kswapd_init(void)
+{
+	if (kswapd_low_wmark == 0)
+	{
+		kswapd_low_wmark = frame_table.free_cnt / 64 > 4 ? frame_table.free_cnt / 64 : 4;
+	}
+	if (kswapd_high_wmark <= kswapd_low_wmark)
+	{
+		kswapd_high_wmark = kswapd_low_wmark * 2;
+	}
+
+	sema_init(&kswapd_sema, 0);
+	kswapd_awake = false;
+	if (thread_create("kswapd", PRI_DEFAULT, kswapd, NULL) == TID_ERROR)
+	{
+		PANIC("kswapd 생성 실패");
+	}
+}
+
+// 빈 프레임이 low watermark 아래면 kswapd를 깨운다.
+// 프레임을 얻는 쪽은 vm_lock을 잡고 있으므로 kswapd_awake는 경쟁 없이 바뀐다.
+static void
+kswapd_wakeup(void)
+{
+	if (!kswapd_awake && frame_table.free_cnt < kswapd_low_wmark)
+	{
+		kswapd_awake = true;
+		sema_up(&kswapd_sema);
+	}
+}
+
+// accessed/dirty 비트로 고른 희생 페이지를 미리 스왑/파일에 써두고 프레임을 비운다.
+static void
+kswapd(void *aux UNUSED)
+{
+	for (;;)
+	{
+		sema_down(&kswapd_sema);
+
+		// 파일을 읽고 있는 프로세스가 있으면 기다리지 않고 익명 프레임만 쫓아낸다.
+		bool fs = lock_try_acquire(&filesys_lock);
+		lock_acquire(&vm_lock);
+		while (frame_table.free_cnt < kswapd_high_wmark)
+		{
+			struct frame *frame = vm_evict_frame();
+			if (frame == NULL)
+			{
+				break;
+			}
+			// 쫓아낼 때 이미 교체 정책에서 뺐다.
+			palloc_free_page(frame->kva);
+			frame_table.free_cnt++;
+		}
+		kswapd_awake = false;
+		lock_release(&vm_lock);
+		if (fs)
+		{
+			lock_release(&filesys_lock);
+		}
+	}
+}
+
+// PAGE가 FRAME을 매핑하도록 연결. 첫 페이지가 프레임의 소유자가 된다.
+static void
+frame_attach(struct frame *frame, struct page *page)
+{
+	list_push_back(&frame->pages, &page->frame_elem);
+	frame->cnt++;
+	if (frame != &zero_frame)
+	{
+		page->thread->spt.rss++;
+	}
+	if (frame->page == NULL)
+	{
+		frame->page = page;
+		frame->pml4 = page->thread->pml4;
+	}
+	page->frame = frame;
+}
+
+// 프레임을 매핑한 페이지 중 하나라도 최근에 참조했으면 true. 모든 매핑의 accessed 비트를 지운다.
+bool frame_test_and_clear_accessed(struct frame *frame)
+{
+	bool accessed = false;
+	struct list_elem *e;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+		if (pml4_is_accessed(page->thread->pml4, page->va))
+		{
+			// huge page의 512 프레임은 PDE의 accessed 비트 하나를 같이 쓴다.
+			// 연속된 프레임을 차례로 지나가므로 영역의 마지막 프레임에서만 지운다.
+			if (!pml4_is_huge(page->thread->pml4, page->va) ||
+				((uint64_t)page->va & (HUGE_PGSIZE - 1)) == HUGE_PGSIZE - PGSIZE)
+			{
+				pml4_set_accessed(page->thread->pml4, page->va, false);
+			}
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+// 프레임을 매핑한 페이지 중 하나라도 내용을 고쳤으면 true
+static bool
+frame_is_dirty(struct frame *frame)
+{
+	struct list_elem *e;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+		if (pml4_is_dirty(page->thread->pml4, page->va))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// 쓰기 없이 바로 버릴 수 있는 프레임인지: 고치지 않은 파일/텍스트 프레임,
+// 또는 스왑 슬롯에 같은 내용이 남아 있는 익명 프레임
+bool frame_is_clean(struct frame *frame)
+{
+	struct page *page = frame->page;
+	if (frame->shm != NULL)
+	{
+		return false;
+	}
+	if (frame->inode != NULL || (page->uninit.type & VM_TEXT))
+	{
+		return !frame_is_dirty(frame);
+	}
+	// COW로 공유 중이면 슬롯이 없는 페이지가 있을 수 있으므로 슬롯에 써야 한다.
+	return VM_TYPE(page->operations->type) == VM_ANON && frame->cnt <= 1 && page->sw_valid &&
+		   !frame_is_dirty(frame);
+}
+
+// 쫓아낼 때 파일에 write back 해야 할 수 있는 프레임: page cache 프레임과 파일 페이지
+static bool
+frame_has_file(struct frame *frame)
+{
+	return frame->inode != NULL ||
+		   (frame->page != NULL && VM_TYPE(frame->page->operations->type) == VM_FILE);
+}
+
+// 쫓아내려면 스왑 공간이 필요한 프레임: 공유 익명 프레임과 슬롯에 같은 내용이 없는 익명 프레임
+static bool
+frame_needs_swap(struct frame *frame)
+{
+	if (frame->shm != NULL)
+	{
+		return true;
+	}
+	if (frame->page == NULL || frame->inode != NULL || (frame->page->uninit.type & VM_TEXT))
+	{
+		return false;
+	}
+	return VM_TYPE(frame->page->operations->type) == VM_ANON && !frame_is_clean(frame);
+}
+
+// 교체 정책이 고를 수 있는 프레임인지
+// 비어있거나 적재 중인 프레임, 고정된 프레임, COW로 공유 중인 파일 페이지 프레임은 안 된다.
+// page cache 프레임은 파일에 써두고 다시 읽을 수 있으므로 공유 중이어도 쫓아낼 수 있다.
+// 공유 익명 프레임은 매핑한 프로세스가 여럿이거나 없어도 스왑에 쓰고 쫓아낼 수 있다.
+// COW로 공유 중인 익명 프레임은 슬롯 하나에 쓰고 모든 페이지가 그 슬롯을 가리키게 한다. (vm_evict_cow)
+// filesys_lock 없이 쫓아내는 쪽(익명 폴트, kswapd)은 파일에 써야 하는 더러운 파일 프레임을 고를 수 없다.
+bool frame_evictable(struct frame *frame)
+{
+	if (evict_swap_full && frame_needs_swap(frame))
+	{
+		return false;
+	}
+	return (frame->page != NULL || frame->shm != NULL) &&
+		   (frame->cnt <= 1 || frame->inode != NULL || frame->shm != NULL ||
+			VM_TYPE(frame->page->operations->type) == VM_ANON) &&
+		   frame->pin_cnt == 0 &&
+		   (!frame_has_file(frame) || !frame_is_dirty(frame) || lock_held_by_current_thread(&filesys_lock));
+}
+
+/* FRAME이 깨끗하면 모든 매핑을 끊고 true. 더러우면 그대로 두고 false.
+ * 검사와 매핑 해제 사이에 다른 프로세스가 쓰지 못하도록 인터럽트를 막는다.
+ * 매핑을 끊은 뒤에는 아무도 고칠 수 없으므로 쫓아낼 때 파일에 쓸 일이 없다. */
+static bool
+frame_unmap_clean(struct frame *frame)
+{
+	enum intr_level old_level = intr_disable();
+	bool clean = !frame_is_dirty(frame);
+	if (clean)
+	{
+		struct list_elem *e;
+		for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+		{
+			struct page *page = list_entry(e, struct page, frame_elem);
+			pml4_clear_page(page->thread->pml4, page->va);
+		}
+	}
+	intr_set_level(old_level);
+	return clean;
+}
+
+// 쓰지 않게 된 프레임을 교체 정책에서 빼고 user pool로 돌려준다.
+static void
+frame_free(struct frame *frame)
+{
+	evict_policy->remove(frame, NULL);
+	palloc_free_page(frame->kva);
+	frame_table.free_cnt++;
+}
+
+// PAGE를 FRAME에서 떼어낸다. 소유자가 떠나면 남은 페이지가 소유자가 된다.
+static void
+frame_detach(struct frame *frame, struct page *page)
+{
+	list_remove(&page->frame_elem);
+	frame->cnt--;
+	if (frame != &zero_frame)
+	{
+		page->thread->spt.rss--;
+	}
+	if (frame->page != page)
+	{
+		return;
+	}
+
+	if (list_empty(&frame->pages))
+	{
+		frame->page = NULL;
+		frame->pml4 = NULL;
+	}
+	else
+	{
+		frame->page = list_entry(list_front(&frame->pages), struct page, frame_elem);
+		frame->pml4 = frame->page->thread->pml4;
+	}
+}
+
+/* Initialize new supplemental page table */
+void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
 {
 	// 해시테이블 초기화 진행
 	// 인자로 get_hash_func, compare_hash_func 함수 사용
 	hash_init(&spt->hash_table, get_hash_func, compare_hash_func, NULL);
+	spt->vma_root = NULL;
+	spt->vma_cache = NULL;
+	spt->swap_next_va = NULL;
+	spt->swap_next_idx = 0;
+	spt->rss = 0;
+	spt->swap_cnt = 0;
+	spt->fault_around_next = NULL;
+	spt->fault_around_window = 0;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -481,58 +1856,95 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 								  struct supplemental_page_table *src UNUSED)
 {
 	struct hash_iterator i;
+	bool succ = true;
+
+	// 프레임 공유 중에 kswapd가 같은 프레임을 쫓아내지 못하도록 잠근다.
+	// 파일은 다시 열기만 하므로 filesys_lock은 필요 없다.
+	int held = vm_lock_acquire(false);
+
+	// 영역을 먼저 복사해야 페이지가 자식의 영역에 매달린다.
+	if (!vma_copy(dst, src))
+	{
+		succ = false;
+		goto done;
+	}
 
 	hash_first(&i, &src->hash_table);
 	while (hash_next(&i))
 	{
 		struct page *page_to_copy = page_entry_from_hash_elem(hash_cur(&i));
+		// 공유 영역의 페이지는 복사하지 않는다. 자식은 폴트 때 공유 객체의 프레임을 매핑한다.
+		if (page_to_copy->vma != NULL && page_to_copy->vma->shm != NULL)
+		{
+			continue;
+		}
 		// 로드된 경우
-		if (page_to_copy->is_loaded)
-		{ // init메모리가 아니라면....
-			vm_alloc_page_with_initializer(page_to_copy->anon.type, page_to_copy->va,
-										   page_to_copy->writable, child_copy_pm, page_to_copy->frame->kva); // NULL에 메모리 로드하는 함수 만들기
-
-			bool flag = false;
-			// merger test lock
-			if (!lock_held_by_current_thread(&filesys_lock))
+		if (page_to_copy->is_loaded && page_to_copy->frame != NULL)
+		{
+			// 프레임을 복사하지 않고 부모와 공유, 쓰기가 일어날 때 복사
+			if (!spt_share_page(dst, page_to_copy))
 			{
-				lock_acquire(&filesys_lock);
-				flag = true;
+				succ = false;
+				break;
 			}
-			// 부모에서 미리 메모리에 할당되있던 곳들은 claim
-			vm_claim_page(page_to_copy->va);
-			if (flag)
+		}
+		// 스왑으로 나간 익명 페이지는 내용을 자식에게 옮겨야 한다.
+		else if (VM_TYPE(page_to_copy->operations->type) == VM_ANON &&
+				 (page_to_copy->zswap != NULL || page_to_copy->sw_valid))
+		{
+			if (!spt_copy_swapped_page(dst, page_to_copy))
 			{
-				flag = false;
-				lock_release(&filesys_lock);
+				succ = false;
+				break;
 			}
 		}
 		// 로드가 안 된 경우
 		else
 		{
-			// 자식에게 전달할 aux
-			void *aux = malloc(sizeof(lazy_load_info));
-
-			memcpy(aux, page_to_copy->uninit.aux, sizeof(lazy_load_info));
+			// 자식에게 전달할 aux, zero 페이지는 aux가 없다.
+			void *aux = NULL;
+			if (page_to_copy->uninit.aux != NULL)
+			{
+				aux = vm_load_info_alloc();
+				if (aux == NULL)
+				{
+					succ = false;
+					break;
+				}
+				memcpy(aux, page_to_copy->uninit.aux, sizeof(lazy_load_info));
+			}
 			// 부모의 페이지로부터 자식 페이지 복사
-			vm_alloc_page_with_initializer(page_to_copy->uninit.type, page_to_copy->va,
-										   page_to_copy->writable, page_to_copy->uninit.init, aux);
+			if (!vm_alloc_page_with_initializer(page_to_copy->uninit.type, page_to_copy->va,
+												page_to_copy->writable, page_to_copy->uninit.init, aux))
+			{
+				vm_load_info_free(aux);
+				succ = false;
+				break;
+			}
+		}
+
+		// mmap 페이지는 자식이 다시 연 파일을 가리키게 한다. (aux는 모든 타입에서 같은 자리)
+		struct page *child = spt_find_page(dst, page_to_copy->va);
+		if (child != NULL && child->vma != NULL && VM_TYPE(child->vma->type) == VM_FILE &&
+			child->uninit.aux != NULL)
+		{
+			((lazy_load_info *)child->uninit.aux)->file = child->vma->file;
 		}
 	}
-	return true;
+
+done:
+	vm_lock_release(held);
+	return succ;
 }
 
 static void hash_action_clear(struct hash_elem *e, void *aux)
 {
 	struct page *page = hash_entry(e, struct page, hash_elem);
 
-	if (page->frame)
-	{
-		free(page->frame);
-	}
-
+	// write back이 유저 매핑을 쓰므로 destroy 후에 프레임을 놓는다.
 	destroy(page);
-	free(page);
+	vm_release_frame(page);
+	slab_free(&page_slab, page);
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -541,17 +1953,12 @@ void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
 
-	bool flag = false;
-	// merger test lock
-	if (!lock_held_by_current_thread(&filesys_lock))
-	{
-		lock_acquire(&filesys_lock);
-		flag = true;
-	}
+	// 더러운 파일 페이지를 write back 하고 mmap 파일을 닫으므로 filesys_lock도 잡는다.
+	int held = vm_lock_acquire(true);
 	hash_clear(&spt->hash_table, hash_action_clear);
-	if (flag)
-	{
-		lock_release(&filesys_lock);
-		flag = false;
-	}
+	// 페이지를 모두 지운 뒤 영역과 mmap 파일을 닫는다.
+	vma_destroy_all(spt);
+	spt->fault_around_next = NULL;
+	spt->fault_around_window = 0;
+	vm_lock_release(held);
 }
@@ -0,0 +1,385 @@
+/* vma.c: 가상 주소 영역(VMA) 관리. 영역은 시작 주소로 정렬된 AVL 트리에 들어 있어서
+ * 찾기, 추가, 삭제가 모두 영역 수에 대해 O(log n)이다. */
+
+#include "vm/vma.h"
+#include <debug.h>
+#include <round.h>
+#include "vm/vm.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "filesys/file.h"
+
+// 영역도 mmap/exec마다 만들고 지우므로 전용 slab cache에서 받는다.
+static struct slab_cache vma_slab;
+
+// slab 생성자: 페이지 리스트는 비어 있는 상태로 돌려받는다.
+static void
+vma_ctor(void *obj)
+{
+	struct vm_area *vma = obj;
+	list_init(&vma->pages);
+}
+
+void vma_init(void)
+{
+	slab_cache_init(&vma_slab, "vm_area", sizeof(struct vm_area), vma_ctor);
+}
+
+static int
+vma_height(struct vm_area *n)
+{
+	return n == NULL ? 0 : n->height;
+}
+
+static void
+vma_update(struct vm_area *n)
+{
+	int l = vma_height(n->left);
+	int r = vma_height(n->right);
+	n->height = (l > r ? l : r) + 1;
+}
+
+static struct vm_area *
+vma_rotate_right(struct vm_area *n)
+{
+	struct vm_area *l = n->left;
+	n->left = l->right;
+	l->right = n;
+	vma_update(n);
+	vma_update(l);
+	return l;
+}
+
+static struct vm_area *
+vma_rotate_left(struct vm_area *n)
+{
+	struct vm_area *r = n->right;
+	n->right = r->left;
+	r->left = n;
+	vma_update(n);
+	vma_update(r);
+	return r;
+}
+
+// 양쪽 높이 차가 2가 된 노드를 회전으로 다시 맞춘다.
+static struct vm_area *
+vma_balance(struct vm_area *n)
+{
+	vma_update(n);
+	int diff = vma_height(n->left) - vma_height(n->right);
+	if (diff > 1)
+	{
+		if (vma_height(n->left->left) < vma_height(n->left->right))
+		{
+			n->left = vma_rotate_left(n->left);
+		}
+		return vma_rotate_right(n);
+	}
+	if (diff < -1)
+	{
+		if (vma_height(n->right->right) < vma_height(n->right->left))
+		{
+			n->right = vma_rotate_right(n->right);
+		}
+		return vma_rotate_left(n);
+	}
+	return n;
+}
+
+static struct vm_area *
+vma_tree_insert(struct vm_area *root, struct vm_area *vma)
+{
+	if (root == NULL)
+	{
+		return vma;
+	}
+	if (vma->start < root->start)
+	{
+		root->left = vma_tree_insert(root->left, vma);
+	}
+	else
+	{
+		root->right = vma_tree_insert(root->right, vma);
+	}
+	return vma_balance(root);
+}
+
+// 가장 왼쪽 노드를 떼어내 *MIN에 담는다.
+static struct vm_area *
+vma_tree_remove_min(struct vm_area *root, struct vm_area **min)
+{
+	if (root->left == NULL)
+	{
+		*min = root;
+		return root->right;
+	}
+	root->left = vma_tree_remove_min(root->left, min);
+	return vma_balance(root);
+}
+
+static struct vm_area *
+vma_tree_remove(struct vm_area *root, struct vm_area *vma)
+{
+	ASSERT(root != NULL);
+
+	if (vma->start < root->start)
+	{
+		root->left = vma_tree_remove(root->left, vma);
+	}
+	else if (vma->start > root->start)
+	{
+		root->right = vma_tree_remove(root->right, vma);
+	}
+	else
+	{
+		if (root->left == NULL || root->right == NULL)
+		{
+			return root->left != NULL ? root->left : root->right;
+		}
+		struct vm_area *succ;
+		struct vm_area *right = vma_tree_remove_min(root->right, &succ);
+		succ->left = root->left;
+		succ->right = right;
+		root = succ;
+	}
+	return vma_balance(root);
+}
+
+// 영역 하나를 해제한다. mmap 영역이면 do_mmap에서 다시 연 파일도 닫는다.
+static void
+vma_free(struct vm_area *vma)
+{
+	if (VM_TYPE(vma->type) == VM_FILE && vma->file != NULL)
+	{
+		file_close(vma->file);
+	}
+	if (vma->shm != NULL)
+	{
+		vm_shm_put(vma->shm);
+	}
+	// 프로세스 종료 때는 페이지를 리스트에서 떼지 않고 지우므로 생성자 상태로 되돌린다.
+	list_init(&vma->pages);
+	slab_free(&vma_slab, vma);
+}
+
+/* [START, START + LENGTH) 범위를 SPT에 영역으로 등록한다. 페이지는 만들지 않는다.
+ * FILE이 있으면 앞의 READ_BYTES 바이트는 FILE의 OFFSET부터 INIT으로 읽고 나머지는 0이다.
+ * 다른 영역과 겹치거나 메모리가 부족하면 NULL. */
+struct vm_area *
+vma_map(struct supplemental_page_table *spt, void *start, size_t length,
+		enum vm_type type, bool writable, vm_initializer *init,
+		struct file *file, off_t offset, size_t read_bytes)
+{
+	ASSERT(pg_ofs(start) == 0);
+	ASSERT(VM_TYPE(type) != VM_UNINIT);
+
+	void *end = start + ROUND_UP(length, PGSIZE);
+	if (length == 0 || end < start || !is_user_vaddr(end - 1) || vma_overlaps(spt, start, end))
+	{
+		return NULL;
+	}
+
+	struct vm_area *vma = slab_alloc(&vma_slab);
+	if (vma == NULL)
+	{
+		return NULL;
+	}
+	vma->start = start;
+	vma->end = end;
+	vma->type = type;
+	vma->writable = writable;
+	vma->init = init;
+	vma->file = file;
+	vma->offset = offset;
+	vma->read_bytes = read_bytes;
+	vma->shm = NULL;
+	vma->left = vma->right = NULL;
+	vma->height = 1;
+
+	spt->vma_root = vma_tree_insert(spt->vma_root, vma);
+	return vma;
+}
+
+/* VMA 안에서 만들어진 페이지를 모두 지우고(더러운 파일 페이지는 write back) 영역을 없앤다.
+ * 건드리지 않은 범위에는 지울 것이 없으므로 만들어진 페이지 수에만 비례한다. */
+void vma_unmap(struct supplemental_page_table *spt, struct vm_area *vma)
+{
+	while (!list_empty(&vma->pages))
+	{
+		struct page *page = list_entry(list_front(&vma->pages), struct page, vma_elem);
+		spt_remove_page(spt, page);
+	}
+
+	spt->vma_root = vma_tree_remove(spt->vma_root, vma);
+	if (spt->vma_cache == vma)
+	{
+		spt->vma_cache = NULL;
+	}
+	vma_free(vma);
+}
+
+/* VA를 포함하는 영역을 찾는다. 없으면 NULL.
+ * 폴트는 같은 영역에 몰려서 나므로 마지막으로 찾은 영역을 먼저 본다. */
+struct vm_area *
+vma_find(struct supplemental_page_table *spt, void *va)
+{
+	struct vm_area *vma = spt->vma_cache;
+	if (vma != NULL && vma->start <= va && va < vma->end)
+	{
+		return vma;
+	}
+
+	vma = spt->vma_root;
+	while (vma != NULL)
+	{
+		if (va < vma->start)
+		{
+			vma = vma->left;
+		}
+		else if (va >= vma->end)
+		{
+			vma = vma->right;
+		}
+		else
+		{
+			spt->vma_cache = vma;
+			return vma;
+		}
+	}
+	return NULL;
+}
+
+// [START, END)와 겹치는 영역 하나를 찾는다. 없으면 NULL.
+static struct vm_area *
+vma_find_overlap(struct supplemental_page_table *spt, void *start, void *end)
+{
+	struct vm_area *vma = spt->vma_root;
+	while (vma != NULL)
+	{
+		if (end <= vma->start)
+		{
+			vma = vma->left;
+		}
+		else if (start >= vma->end)
+		{
+			vma = vma->right;
+		}
+		else
+		{
+			return vma;
+		}
+	}
+	return NULL;
+}
+
+// [START, END)와 겹치는 영역이 하나라도 있으면 true
+bool vma_overlaps(struct supplemental_page_table *spt, void *start, void *end)
+{
+	return vma_find_overlap(spt, start, end) != NULL;
+}
+
+/* TOP 아래에서 LENGTH 바이트가 들어갈 빈 주소 범위를 위에서부터 찾아 시작 주소를 반환한다.
+ * 겹치는 영역이 있으면 그 영역 아래로 내려가서 다시 본다. 자리가 없으면 NULL. (주소를 정하지 않은 mmap) */
+void *
+vma_find_free(struct supplemental_page_table *spt, size_t length, void *top)
+{
+	length = ROUND_UP(length, PGSIZE);
+	void *end = pg_round_down(top);
+	while (length != 0 && (uintptr_t)end >= length + PGSIZE)
+	{
+		struct vm_area *vma = vma_find_overlap(spt, end - length, end);
+		if (vma == NULL)
+		{
+			return end - length;
+		}
+		end = vma->start;
+	}
+	return NULL;
+}
+
+/* 스택 성장: VMA의 시작을 START까지 내린다. 사이에 다른 영역이 없으면
+ * 트리 순서가 그대로이므로 다시 넣을 필요가 없다. */
+bool vma_grow_down(struct supplemental_page_table *spt, struct vm_area *vma, void *start)
+{
+	ASSERT(pg_ofs(start) == 0);
+
+	if (start >= vma->start)
+	{
+		return true;
+	}
+	if (vma_overlaps(spt, start, vma->start))
+	{
+		return false;
+	}
+	vma->start = start;
+	return true;
+}
+
+// SRC 서브트리의 영역들을 DST에 복사한다. 페이지는 supplemental_page_table_copy가 옮긴다.
+static bool
+vma_copy_tree(struct supplemental_page_table *dst, struct vm_area *src)
+{
+	if (src == NULL)
+	{
+		return true;
+	}
+	if (!vma_copy_tree(dst, src->left))
+	{
+		return false;
+	}
+
+	// mmap 영역은 자식이 자기 파일을 가진다.
+	struct file *file = src->file;
+	if (VM_TYPE(src->type) == VM_FILE && file != NULL)
+	{
+		file = file_reopen(file);
+		if (file == NULL)
+		{
+			return false;
+		}
+	}
+	struct vm_area *vma = vma_map(dst, src->start, src->end - src->start, src->type, src->writable,
+								  src->init, file, src->offset, src->read_bytes);
+	if (vma == NULL)
+	{
+		if (file != src->file)
+		{
+			file_close(file);
+		}
+		return false;
+	}
+	// 공유 영역은 자식도 같은 페이지들을 본다.
+	if (src->shm != NULL)
+	{
+		vma->shm = src->shm;
+		vma->shm->ref++;
+	}
+
+	return vma_copy_tree(dst, src->right);
+}
+
+// SRC의 영역 구성을 DST에 그대로 복사한다. (fork)
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src)
+{
+	return vma_copy_tree(dst, src->vma_root);
+}
+
+static void
+vma_destroy_tree(struct vm_area *vma)
+{
+	if (vma == NULL)
+	{
+		return;
+	}
+	vma_destroy_tree(vma->left);
+	vma_destroy_tree(vma->right);
+	vma_free(vma);
+}
+
+// 모든 영역을 해제한다. 페이지는 호출 전에 supplemental_page_table_kill이 지운다.
+void vma_destroy_all(struct supplemental_page_table *spt)
+{
+	vma_destroy_tree(spt->vma_root);
+	spt->vma_root = NULL;
+	spt->vma_cache = NULL;
+}
@@ -0,0 +1,303 @@
+/* zswap.c: 스왑 디스크 앞단의 압축 스왑 캐시. */
+
+#include "vm/zswap.h"
+#include <list.h>
+#include <string.h>
+#include <debug.h>
+#include "vm/vm.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* 압축된 페이지 하나. LRU 순서로 zswap.lru에 매달린다. */
+struct zswap_entry
+{
+	struct page *page;	   // 이 항목의 주인 페이지
+	struct list_elem elem; // zswap.lru element
+	size_t len;			   // 압축된 길이
+	uint8_t data[];		   // 압축된 내용
+};
+
+// 캐시 전체 상태. swap_out/swap_in처럼 vm_lock 아래에서만 바뀐다.
+static struct
+{
+	struct list lru;  // 앞쪽이 가장 오래된 항목
+	size_t used;	  // 항목들이 차지한 바이트 수
+	size_t max;		  // used의 한도
+	uint8_t *comp_buf; // 압축 결과를 담을 페이지
+	uint8_t *wb_buf;   // 디스크로 내려보낼 때 풀어둘 페이지
+} zswap;
+
+size_t zswap_max_pages = ZSWAP_AUTO;
+
+/* LZ 압축: 8개 토큰마다 제어 바이트 하나를 두고, 각 비트가 0이면 리터럴 1바이트,
+ * 1이면 매치 2바이트(12비트 거리, 4비트 길이)다. 길이 코드가 15면 바이트 하나가 더 붙는다. */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_OFFSET 4095
+#define LZ_LONG_MATCH (LZ_MIN_MATCH + 15)
+#define LZ_MAX_MATCH (LZ_LONG_MATCH + 255)
+
+// 이보다 크게 압축되면 디스크에 쓰는 편이 낫다.
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+// 세 바이트 해시 -> 그 자리 위치 + 1 (0은 비어 있음)
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static size_t lz_compress(const uint8_t *src, uint8_t *dst, size_t dst_max);
+static bool lz_decompress(const uint8_t *src, size_t len, uint8_t *dst);
+static bool zswap_writeback(void);
+
+void zswap_init(void)
+{
+	list_init(&zswap.lru);
+	zswap.used = 0;
+	if (zswap_max_pages == ZSWAP_AUTO)
+	{
+		zswap_max_pages = palloc_user_page_cnt() / 4;
+	}
+	zswap.max = zswap_max_pages * PGSIZE;
+	zswap.comp_buf = palloc_get_page(PAL_ASSERT);
+	zswap.wb_buf = palloc_get_page(PAL_ASSERT);
+}
+
+// KVA의 내용을 압축해서 PAGE를 캐시에 넣는다.
+// 잘 압축되지 않거나 한도 안에 자리를 만들 수 없으면 false, 호출자가 디스크에 쓴다.
+bool zswap_store(struct page *page, const void *kva)
+{
+	ASSERT(page->zswap == NULL);
+
+	if (zswap.max == 0)
+	{
+		return false;
+	}
+	size_t len = lz_compress(kva, zswap.comp_buf, ZSWAP_MAX_LEN);
+	if (len == 0)
+	{
+		return false;
+	}
+
+	size_t size = sizeof(struct zswap_entry) + len;
+	if (size > zswap.max)
+	{
+		return false;
+	}
+	// 넘치면 가장 오래된 항목부터 디스크로 내려보낸다.
+	while (zswap.used + size > zswap.max)
+	{
+		if (!zswap_writeback())
+		{
+			return false;
+		}
+	}
+
+	struct zswap_entry *entry = malloc(size);
+	if (entry == NULL)
+	{
+		return false;
+	}
+	entry->page = page;
+	entry->len = len;
+	memcpy(entry->data, zswap.comp_buf, len);
+	list_push_back(&zswap.lru, &entry->elem);
+	zswap.used += size;
+	page->zswap = entry;
+	page->thread->spt.swap_cnt++;
+	return true;
+}
+
+// 캐시에 있는 PAGE를 KVA에 풀고 항목을 지운다.
+void zswap_load(struct page *page, void *kva)
+{
+	zswap_read(page, kva);
+	zswap_free(page);
+}
+
+// 항목은 그대로 두고 KVA에 풀기만 한다. fork가 부모의 항목을 복사할 때 쓴다.
+void zswap_read(const struct page *page, void *kva)
+{
+	struct zswap_entry *entry = page->zswap;
+	ASSERT(entry != NULL);
+
+	if (!lz_decompress(entry->data, entry->len, kva))
+	{
+		PANIC("zswap: 압축 데이터 손상");
+	}
+}
+
+// PAGE의 항목이 있으면 지운다.
+void zswap_free(struct page *page)
+{
+	struct zswap_entry *entry = page->zswap;
+	if (entry == NULL)
+	{
+		return;
+	}
+	list_remove(&entry->elem);
+	zswap.used -= sizeof(struct zswap_entry) + entry->len;
+	page->zswap = NULL;
+	page->thread->spt.swap_cnt--;
+	free(entry);
+}
+
+// 가장 오래된 항목 하나를 풀어서 스왑 디스크로 옮긴다.
+static bool
+zswap_writeback(void)
+{
+	if (list_empty(&zswap.lru))
+	{
+		return false;
+	}
+	struct zswap_entry *entry = list_entry(list_front(&zswap.lru), struct zswap_entry, elem);
+	struct page *page = entry->page;
+
+	if (!lz_decompress(entry->data, entry->len, zswap.wb_buf))
+	{
+		PANIC("zswap: 압축 데이터 손상");
+	}
+	if (!anon_swap_to_disk(page, zswap.wb_buf))
+	{
+		return false;
+	}
+	zswap_free(page);
+	return true;
+}
+
+static inline unsigned
+lz_hash(const uint8_t *p)
+{
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// 한 페이지를 DST에 압축하고 길이를 돌려준다. DST_MAX를 넘으면 0.
+static size_t
+lz_compress(const uint8_t *src, uint8_t *dst, size_t dst_max)
+{
+	size_t ip = 0, op = 0, ctrl = 0;
+	int bit = 8;
+
+	memset(lz_table, 0, sizeof lz_table);
+	while (ip < PGSIZE)
+	{
+		if (bit == 8)
+		{
+			if (op + 1 > dst_max)
+			{
+				return 0;
+			}
+			ctrl = op++;
+			dst[ctrl] = 0;
+			bit = 0;
+		}
+
+		// 같은 해시를 가진 직전 위치와 비교해서 매치를 찾는다.
+		size_t len = 0, off = 0;
+		if (ip + LZ_MIN_MATCH <= PGSIZE)
+		{
+			unsigned h = lz_hash(src + ip);
+			size_t cand = lz_table[h];
+			lz_table[h] = ip + 1;
+			if (cand != 0 && ip - (cand - 1) <= LZ_MAX_OFFSET)
+			{
+				cand--;
+				off = ip - cand;
+				while (ip + len < PGSIZE && len < LZ_MAX_MATCH && src[cand + len] == src[ip + len])
+				{
+					len++;
+				}
+			}
+		}
+
+		if (len >= LZ_MIN_MATCH)
+		{
+			size_t need = len >= LZ_LONG_MATCH ? 3 : 2;
+			if (op + need > dst_max)
+			{
+				return 0;
+			}
+			dst[ctrl] |= 1 << bit;
+			dst[op++] = off >> 4;
+			if (len >= LZ_LONG_MATCH)
+			{
+				dst[op++] = (off & 0xf) << 4 | 15;
+				dst[op++] = len - LZ_LONG_MATCH;
+			}
+			else
+			{
+				dst[op++] = (off & 0xf) << 4 | (len - LZ_MIN_MATCH);
+			}
+			ip += len;
+		}
+		else
+		{
+			if (op + 1 > dst_max)
+			{
+				return 0;
+			}
+			dst[op++] = src[ip++];
+		}
+		bit++;
+	}
+	return op;
+}
+
+// lz_compress의 결과 LEN 바이트를 한 페이지로 푼다. 형식이 어긋나면 false.
+static bool
+lz_decompress(const uint8_t *src, size_t len, uint8_t *dst)
+{
+	size_t ip = 0, op = 0;
+	uint8_t ctrl = 0;
+	int bit = 8;
+
+	while (op < PGSIZE)
+	{
+		if (bit == 8)
+		{
+			if (ip >= len)
+			{
+				return false;
+			}
+			ctrl = src[ip++];
+			bit = 0;
+		}
+
+		if (ctrl & (1 << bit))
+		{
+			if (ip + 2 > len)
+			{
+				return false;
+			}
+			size_t off = (size_t)src[ip] << 4 | src[ip + 1] >> 4;
+			size_t mlen = (src[ip + 1] & 0xf) + LZ_MIN_MATCH;
+			ip += 2;
+			if (mlen == LZ_LONG_MATCH)
+			{
+				if (ip >= len)
+				{
+					return false;
+				}
+				mlen += src[ip++];
+			}
+			if (off == 0 || off > op || op + mlen > PGSIZE)
+			{
+				return false;
+			}
+			// 겹치는 매치(거리 < 길이)가 있으므로 한 바이트씩 복사한다.
+			for (size_t i = 0; i < mlen; i++, op++)
+			{
+				dst[op] = dst[op - off];
+			}
+		}
+		else
+		{
+			if (ip >= len)
+			{
+				return false;
+			}
+			dst[op++] = src[ip++];
+		}
+		bit++;
+	}
+	return true;
+}